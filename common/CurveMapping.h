@@ -37,6 +37,18 @@ namespace FABB
 		T Unmap(T v) const { return mAo + mAr * std::log(v * mRcpSc) * mRcpPw; }
 	};
 
+	// a curve sampled at the N integers from al, for the parameters of a small integer domain
+	// filled once from any function of T, e.g. the Map of a curve above, looked up with clamping
+	template<typename T, int N> class CurveMapTable
+	{
+	protected:
+		int mAo;
+		T mTable[N];
+	public:
+		template<typename F> CurveMapTable(F f, int al = 0) : mAo(al) { for(int i = 0; i < N; i ++) mTable[i] = f((T)(al + i)); }
+		T Map(int v) const { int i = v - mAo; return mTable[(i < 0) ? 0 : (N <= i) ? (N - 1) : i]; }
+	};
+
 	using CurveMapLinearF = CurveMapLinear<float>;
 	using CurveMapLinearD = CurveMapLinear<double>;
 	using CurveMapExponentialF = CurveMapExponential<float>;
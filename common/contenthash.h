@@ -0,0 +1,113 @@
+//
+//  contenthash.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "strutil.h"
+
+// 128-bit content key, made of two XXH64 of the data with different seeds
+struct ContentHash
+{
+	enum : uint64_t
+	{
+		Prime1 = 11400714785074694791ULL,
+		Prime2 = 14029467366897019727ULL,
+		Prime3 = 1609587929392839161ULL,
+		Prime4 = 9650029242287828579ULL,
+		Prime5 = 2870177450012600261ULL,
+	};
+	uint64_t h0, h1;
+	static uint64_t rotl(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+	// little endian host
+	static uint64_t read64(const uint8_t* p)
+	{
+		uint64_t v; memcpy(&v, p, sizeof(v)); return v;
+	}
+	static uint32_t read32(const uint8_t* p)
+	{
+		uint32_t v; memcpy(&v, p, sizeof(v)); return v;
+	}
+	static uint64_t round(uint64_t acc, uint64_t input)
+	{
+		acc += input * Prime2;
+		return rotl(acc, 31) * Prime1;
+	}
+	static uint64_t mergeRound(uint64_t acc, uint64_t val)
+	{
+		acc ^= round(0, val);
+		return acc * Prime1 + Prime4;
+	}
+	static uint64_t xxh64(const void* data, size_t len, uint64_t seed)
+	{
+		const uint8_t* p = (const uint8_t*)data;
+		const uint8_t* end = p + len;
+		uint64_t h;
+		if(32 <= len)
+		{
+			const uint8_t* limit = end - 32;
+			uint64_t v1 = seed + Prime1 + Prime2, v2 = seed + Prime2, v3 = seed, v4 = seed - Prime1;
+			do
+			{
+				v1 = round(v1, read64(p + 0));
+				v2 = round(v2, read64(p + 8));
+				v3 = round(v3, read64(p + 16));
+				v4 = round(v4, read64(p + 24));
+				p += 32;
+			} while(p <= limit);
+			h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+			h = mergeRound(h, v1);
+			h = mergeRound(h, v2);
+			h = mergeRound(h, v3);
+			h = mergeRound(h, v4);
+		}
+		else
+		{
+			h = seed + Prime5;
+		}
+		h += (uint64_t)len;
+		for(; p + 8 <= end; p += 8) h = rotl(h ^ round(0, read64(p)), 27) * Prime1 + Prime4;
+		if(p + 4 <= end) { h = rotl(h ^ ((uint64_t)read32(p) * Prime1), 23) * Prime2 + Prime3; p += 4; }
+		for(; p < end; p ++) h = rotl(h ^ (*p * Prime5), 11) * Prime1;
+		h ^= h >> 33;
+		h *= Prime2;
+		h ^= h >> 29;
+		h *= Prime3;
+		h ^= h >> 32;
+		return h;
+	}
+	static ContentHash compute(const void* data, size_t len)
+	{
+		return { xxh64(data, len, 0), xxh64(data, len, Prime5) };
+	}
+	bool operator==(const ContentHash& o) const
+	{
+		return (h0 == o.h0) && (h1 == o.h1);
+	}
+	bool operator<(const ContentHash& o) const
+	{
+		return (h0 != o.h0) ? (h0 < o.h0) : (h1 < o.h1);
+	}
+	std::string toString() const
+	{
+		return StrUtil::format(40, "%016llx%016llx", (unsigned long long)h0, (unsigned long long)h1);
+	}
+	// parses the 32 hex digits of toString()
+	static bool fromString(const std::string& s, ContentHash* hash)
+	{
+		if((s.size() != 32) || (s.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)) return false;
+		hash->h0 = std::strtoull(s.substr(0, 16).c_str(), nullptr, 16);
+		hash->h1 = std::strtoull(s.substr(16).c_str(), nullptr, 16);
+		return true;
+	}
+};
@@ -0,0 +1,77 @@
+//
+//  cpufeatures.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+#define TXW_X86 1
+#include <immintrin.h>
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define TXW_X86 0
+#endif
+
+// functions using AVX2 intrinsics must be compiled for that target on gcc/clang,
+// while msvc accepts the intrinsics anywhere
+#if TXW_X86 && !defined _MSC_VER
+#define TXW_TARGET_SSE2 __attribute__((target("sse2")))
+#define TXW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TXW_TARGET_SSE2
+#define TXW_TARGET_AVX2
+#endif
+
+struct CpuFeatures
+{
+	enum Level
+	{
+		LevelScalar = 0,
+		LevelSSE2,
+		LevelAVX2,
+	};
+	// the highest instruction set level usable on this machine, detected once
+	static Level getLevel()
+	{
+		static const Level level = detect();
+		return level;
+	}
+	static const char* getLevelName(Level l)
+	{
+		static const char* names[] = { "scalar", "sse2", "avx2" };
+		return names[l];
+	}
+private:
+	static Level detect()
+	{
+#if TXW_X86
+#if defined _MSC_VER
+		int r[4] = {};
+		__cpuid(r, 0);
+		int maxid = r[0];
+		__cpuid(r, 1);
+		bool sse2 = (r[3] & (1 << 26)) != 0;
+		bool osxsave = (r[2] & (1 << 27)) != 0;
+		bool avx = (r[2] & (1 << 28)) != 0;
+		bool avx2 = false;
+		if((7 <= maxid) && osxsave && avx && ((_xgetbv(0) & 0x06) == 0x06))
+		{
+			__cpuidex(r, 7, 0);
+			avx2 = (r[1] & (1 << 5)) != 0;
+		}
+		if(avx2) return LevelAVX2;
+		if(sse2) return LevelSSE2;
+#else
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2")) return LevelAVX2;
+		if(__builtin_cpu_supports("sse2")) return LevelSSE2;
+#endif
+#endif
+		return LevelScalar;
+	}
+};
@@ -0,0 +1,243 @@
+//
+//  dirwatcher.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined __linux__
+#include <limits.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined _WIN32
+#if !defined WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// the changes of the files under a directory tree, the directories created or moved in later included.
+// inotify on linux tells when a file is closed after writing, ReadDirectoryChangesW on windows only that it has changed,
+// and elsewhere the tree is scanned again for the sizes and the times at each wait.
+// a directory moved in is reported as the files in it, as they have landed before it could be watched.
+class DirWatcher
+{
+public:
+	enum Type
+	{
+		Writing = 0, // created or written, and still open
+		Written, // closed after writing, moved in, or changed if it is not known whether it is still open
+		Removed, // deleted or moved out
+	};
+	struct EVENT
+	{
+		std::filesystem::path path;
+		Type type;
+	};
+	static const char* getMethodName()
+	{
+#if defined __linux__
+		return "inotify";
+#elif defined _WIN32
+		return "ReadDirectoryChangesW";
+#else
+		return "polling";
+#endif
+	}
+protected:
+	std::filesystem::path mRoot;
+	static void addFiles(const std::filesystem::path& dir, std::vector<EVENT>* events)
+	{
+		std::error_code ec;
+		for(std::filesystem::recursive_directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec), end; !ec && (it != end); it.increment(ec))
+		{
+			std::error_code ecf;
+			if(it->is_regular_file(ecf)) events->push_back({ it->path(), Written });
+		}
+	}
+#if defined __linux__
+	int mFD;
+	std::map<int, std::filesystem::path> mWatches;
+	std::vector<char> mBuffer;
+	// the directory and the directories under it
+	void addWatches(const std::filesystem::path& dir)
+	{
+		const uint32_t mask = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+		int wd = inotify_add_watch(mFD, dir.c_str(), mask);
+		if(wd < 0) return;
+		mWatches[wd] = dir;
+		std::error_code ec;
+		for(std::filesystem::recursive_directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, ec), end; !ec && (it != end); it.increment(ec))
+		{
+			std::error_code ecd;
+			if(!it->is_directory(ecd)) continue;
+			int wdsub = inotify_add_watch(mFD, it->path().c_str(), mask);
+			if(0 <= wdsub) mWatches[wdsub] = it->path();
+		}
+	}
+#elif defined _WIN32
+	HANDLE mDir;
+	OVERLAPPED mOverlapped;
+	std::vector<DWORD> mBuffer;
+	bool mPending;
+	void issue()
+	{
+		const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+		ResetEvent(mOverlapped.hEvent);
+		mPending = ReadDirectoryChangesW(mDir, mBuffer.data(), (DWORD)(mBuffer.size() * sizeof(DWORD)), TRUE, filter, nullptr, &mOverlapped, nullptr) != FALSE;
+		if(!mPending) throw std::runtime_error("failed to watch: \"" + mRoot.filename().string() + "\"");
+	}
+#else
+	enum { PollInterval = 500 }; // ms
+	struct STATE
+	{
+		uintmax_t size;
+		std::filesystem::file_time_type time;
+	};
+	std::map<std::filesystem::path, STATE> mFiles;
+	std::map<std::filesystem::path, STATE> scan() const
+	{
+		std::map<std::filesystem::path, STATE> files;
+		std::error_code ec;
+		for(std::filesystem::recursive_directory_iterator it(mRoot, std::filesystem::directory_options::skip_permission_denied, ec), end; !ec && (it != end); it.increment(ec))
+		{
+			std::error_code ecf;
+			if(!it->is_regular_file(ecf)) continue;
+			STATE st = { it->file_size(ecf), it->last_write_time(ecf) };
+			if(!ecf) files[it->path()] = st;
+		}
+		return files;
+	}
+#endif
+public:
+	// throws on failure
+	DirWatcher(const std::filesystem::path& root) : mRoot(root)
+	{
+#if defined __linux__
+		mBuffer.resize(65536);
+		mFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(mFD < 0) throw std::runtime_error("failed to watch: \"" + root.filename().string() + "\"");
+		addWatches(root);
+		if(mWatches.empty())
+		{
+			::close(mFD);
+			throw std::runtime_error("failed to watch: \"" + root.filename().string() + "\"");
+		}
+#elif defined _WIN32
+		mBuffer.resize(16384);
+		mOverlapped = {};
+		mPending = false;
+		mDir = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if(mDir == INVALID_HANDLE_VALUE) throw std::runtime_error("failed to watch: \"" + root.filename().string() + "\"");
+		mOverlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		try { issue(); }
+		catch(...) { CloseHandle(mOverlapped.hEvent); CloseHandle(mDir); throw; }
+#else
+		mFiles = scan();
+#endif
+	}
+	~DirWatcher()
+	{
+#if defined __linux__
+		::close(mFD);
+#elif defined _WIN32
+		if(mPending)
+		{
+			// the buffer must not be freed before the cancelled read completes
+			DWORD bytes = 0;
+			CancelIoEx(mDir, &mOverlapped);
+			GetOverlappedResult(mDir, &mOverlapped, &bytes, TRUE);
+		}
+		CloseHandle(mOverlapped.hEvent);
+		CloseHandle(mDir);
+#endif
+	}
+	DirWatcher(const DirWatcher&) = delete;
+	DirWatcher& operator=(const DirWatcher&) = delete;
+	// waits up to timeoutms for the changes and appends them to events, false if none.
+	// overflow is set if some changes were lost, then the tree must be scanned again
+	bool wait(unsigned int timeoutms, std::vector<EVENT>* events, bool* overflow)
+	{
+		size_t count = events->size();
+		*overflow = false;
+#if defined __linux__
+		pollfd pfd = { mFD, POLLIN, 0 };
+		if(::poll(&pfd, 1, (int)timeoutms) <= 0) return false;
+		for(;;)
+		{
+			ssize_t c = ::read(mFD, mBuffer.data(), mBuffer.size());
+			if(c <= 0) break;
+			for(ssize_t pos = 0; pos < c;)
+			{
+				const inotify_event* ev = (const inotify_event*)(mBuffer.data() + pos);
+				pos += sizeof(inotify_event) + ev->len;
+				if(ev->mask & IN_Q_OVERFLOW) { *overflow = true; continue; }
+				if(ev->mask & IN_IGNORED) { mWatches.erase(ev->wd); continue; }
+				auto it = mWatches.find(ev->wd);
+				if((it == mWatches.end()) || (ev->len == 0)) continue;
+				std::filesystem::path path = it->second / ev->name;
+				if(ev->mask & IN_ISDIR)
+				{
+					if(ev->mask & (IN_CREATE | IN_MOVED_TO))
+					{
+						addWatches(path);
+						addFiles(path, events);
+					}
+					continue;
+				}
+				if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) events->push_back({ path, Removed });
+				else if(ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) events->push_back({ path, Written });
+				else if(ev->mask & (IN_CREATE | IN_MODIFY)) events->push_back({ path, Writing });
+			}
+		}
+#elif defined _WIN32
+		if(WaitForSingleObject(mOverlapped.hEvent, timeoutms) != WAIT_OBJECT_0) return false;
+		DWORD bytes = 0;
+		mPending = false;
+		if(!GetOverlappedResult(mDir, &mOverlapped, &bytes, FALSE)) bytes = 0;
+		// no bytes if the changes did not fit in the buffer
+		if(bytes == 0) *overflow = true;
+		for(const uint8_t* p = (const uint8_t*)mBuffer.data(); bytes != 0;)
+		{
+			const FILE_NOTIFY_INFORMATION* fni = (const FILE_NOTIFY_INFORMATION*)p;
+			std::filesystem::path path = mRoot / std::wstring(fni->FileName, fni->FileNameLength / sizeof(WCHAR));
+			std::error_code ec;
+			if((fni->Action == FILE_ACTION_REMOVED) || (fni->Action == FILE_ACTION_RENAMED_OLD_NAME)) events->push_back({ path, Removed });
+			else if(std::filesystem::is_directory(path, ec))
+			{
+				if((fni->Action == FILE_ACTION_ADDED) || (fni->Action == FILE_ACTION_RENAMED_NEW_NAME)) addFiles(path, events);
+			}
+			else events->push_back({ path, Written });
+			if(fni->NextEntryOffset == 0) break;
+			p += fni->NextEntryOffset;
+		}
+		issue();
+#else
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutms, (unsigned int)PollInterval)));
+		std::map<std::filesystem::path, STATE> files = scan();
+		for(const auto& it : files)
+		{
+			auto old = mFiles.find(it.first);
+			if((old == mFiles.end()) || (old->second.size != it.second.size) || (old->second.time != it.second.time)) events->push_back({ it.first, Written });
+		}
+		for(const auto& it : mFiles) if(files.find(it.first) == files.end()) events->push_back({ it.first, Removed });
+		mFiles.swap(files);
+#endif
+		return (count < events->size()) || *overflow;
+	}
+};
@@ -0,0 +1,147 @@
+//
+//  fatimage.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "strutil.h"
+
+// raw image of an MS-DOS formatted diskette, as written by TX16W (720K) or a PC (1.44M)
+// the FAT12 filesystem is parsed in place from a single mapping of the image file, or from the image in memory.
+// only the root directory is read, TX16W does not make subdirectories.
+class FATImage
+{
+public:
+	struct ENTRY
+	{
+		std::string name; // "NAME.EXT"
+		uint32_t size;
+		uint16_t cluster;
+	};
+protected:
+	std::unique_ptr<MappedFile> mFile;
+	const uint8_t* mData;
+	size_t mSize;
+	uint32_t mBytesPerCluster;
+	uint32_t mFATOffset, mDataOffset, mNumClusters;
+	std::vector<ENTRY> mEntries;
+	static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+	static uint32_t getU32(const uint8_t* p) { return (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)); }
+	uint16_t getNextCluster(uint16_t cluster) const
+	{
+		const uint8_t* p = mData + mFATOffset + cluster * 3 / 2;
+		uint16_t v = getU16(p);
+		return (cluster & 0x01) ? (v >> 4) : (v & 0x0fff);
+	}
+	const uint8_t* getCluster(uint16_t cluster) const
+	{
+		if((cluster < 2) || (mNumClusters + 2 <= cluster)) throw std::runtime_error("corrupted image: invalid cluster");
+		return mData + mDataOffset + (cluster - 2) * mBytesPerCluster;
+	}
+	void parse(const std::string& name)
+	{
+		const uint8_t* p = mData;
+		size_t c = mSize;
+		if(c < 512) throw std::runtime_error("invalid image: \"" + name + "\"");
+		// take the geometry from the BPB, or from the image size if the boot sector is not a DOS one
+		uint32_t bps = getU16(p + 0x0b), spc = p[0x0d], reserved = getU16(p + 0x0e), numfats = p[0x10];
+		uint32_t rootentries = getU16(p + 0x11), totalsectors = getU16(p + 0x13), fatsectors = getU16(p + 0x16);
+		bool bpbvalid = (bps == 512) && (spc != 0) && ((spc & (spc - 1)) == 0) && (reserved != 0) && (numfats != 0) && (rootentries != 0) && (fatsectors != 0);
+		if(!bpbvalid)
+		{
+			if     (c == 737280)  { bps = 512; spc = 2; reserved = 1; numfats = 2; rootentries = 112; totalsectors = 1440; fatsectors = 3; }
+			else if(c == 1474560) { bps = 512; spc = 1; reserved = 1; numfats = 2; rootentries = 224; totalsectors = 2880; fatsectors = 9; }
+			else throw std::runtime_error("invalid image: \"" + name + "\"");
+		}
+		if(totalsectors == 0) totalsectors = getU32(p + 0x20);
+		mBytesPerCluster = bps * spc;
+		mFATOffset = reserved * bps;
+		uint32_t rootoffset = mFATOffset + numfats * fatsectors * bps;
+		mDataOffset = rootoffset + (rootentries * 32 + bps - 1) / bps * bps;
+		uint32_t imagesize = (uint32_t)std::min<size_t>(c, (size_t)totalsectors * bps);
+		if(imagesize < mDataOffset) throw std::runtime_error("invalid image: \"" + name + "\"");
+		// FAT12 holds at most 4084 clusters, and the FAT itself must cover them
+		mNumClusters = std::min<uint32_t>((imagesize - mDataOffset) / mBytesPerCluster, std::min<uint32_t>(4084, fatsectors * bps * 2 / 3 - 2));
+		for(uint32_t ie = 0; ie < rootentries; ie ++)
+		{
+			const uint8_t* de = p + rootoffset + ie * 32;
+			if(de[0] == 0x00) break;
+			if(de[0] == 0xe5) continue;
+			uint8_t attr = de[11];
+			if((attr & 0x18) != 0) continue; // volume label, long name or directory
+			std::string base = StrUtil::trim(std::string((const char*)de, 8), " ");
+			std::string ext = StrUtil::trim(std::string((const char*)de + 8, 3), " ");
+			if(base.empty()) continue;
+			if(base[0] == 0x05) base[0] = (char)0xe5;
+			ENTRY ent = { ext.empty() ? base : (base + "." + ext), getU32(de + 28), getU16(de + 26) };
+			mEntries.push_back(ent);
+		}
+	}
+public:
+	// maps the image file, throws on failure
+	FATImage(const std::filesystem::path& path) : mFile(new MappedFile(path)), mData(mFile->data()), mSize(mFile->size())
+	{
+		parse(path.filename().string());
+	}
+	// parses a caller owned image, which must outlive this, throws on failure
+	FATImage(const uint8_t* p, size_t c) : mData(p), mSize(c)
+	{
+		parse("(memory)");
+	}
+	FATImage(const FATImage&) = delete;
+	FATImage& operator=(const FATImage&) = delete;
+	// the standard extensions of raw diskette images
+	static bool isImageFile(const std::filesystem::path& path)
+	{
+		static const char* exts[] = { ".img", ".ima", ".dsk", ".flp", ".vfd" };
+		std::string ext = path.extension().string();
+		for(const char* e : exts) if(StrUtil::isEqualNoCase(ext, e)) return std::filesystem::is_regular_file(path);
+		return false;
+	}
+	const std::vector<ENTRY>& getEntries() const
+	{
+		return mEntries;
+	}
+	// case insensitive, nullptr if not found
+	const ENTRY* find(const std::string& name) const
+	{
+		for(const ENTRY& ent : mEntries) if(StrUtil::isEqualNoCase(ent.name, name)) return &ent;
+		return nullptr;
+	}
+	// returns a pointer into the image if the file is stored in consecutive clusters,
+	// otherwise gathers the clusters into buf and returns buf.data()
+	const uint8_t* getFileData(const ENTRY& ent, std::vector<uint8_t>& buf) const
+	{
+		if(ent.size == 0) return nullptr;
+		uint32_t numclusters = (ent.size + mBytesPerCluster - 1) / mBytesPerCluster;
+		if(mNumClusters < numclusters) throw std::runtime_error("corrupted image: \"" + ent.name + "\"");
+		std::vector<uint16_t> chain;
+		chain.reserve(numclusters);
+		for(uint16_t cluster = ent.cluster; chain.size() < numclusters; cluster = getNextCluster(cluster))
+		{
+			if((cluster < 2) || (mNumClusters + 2 <= cluster)) throw std::runtime_error("corrupted image: \"" + ent.name + "\"");
+			chain.push_back(cluster);
+		}
+		bool contiguous = true;
+		for(size_t i = 1; contiguous && (i < chain.size()); i ++) contiguous = chain[i] == chain[i - 1] + 1;
+		if(contiguous) return getCluster(chain.front());
+		buf.resize(ent.size);
+		for(size_t i = 0; i < chain.size(); i ++)
+		{
+			size_t offset = i * mBytesPerCluster;
+			memcpy(buf.data() + offset, getCluster(chain[i]), std::min<size_t>(mBytesPerCluster, ent.size - offset));
+		}
+		return buf.data();
+	}
+};
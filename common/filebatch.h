@@ -0,0 +1,104 @@
+//
+//  filebatch.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "filesource.h"
+#include "threadpool.h"
+
+// files of a source opened together as jobs of a pool, so that the latencies of a slow filesystem overlap
+// instead of adding up. each job also reads the first bytes of its file, i.e. faults in the header of a mapping.
+// the opened files are then looked up or taken by name, a failed open is left to the caller to repeat and report.
+class FileBatch
+{
+protected:
+	struct ENTRY
+	{
+		FileSource::File file;
+		bool opened = false;
+	};
+	mutable std::mutex mMutex;
+	std::map<std::string, ENTRY> mEntries;
+	static void touch(const FileSource::File& file, size_t bytes)
+	{
+		const uint8_t* p = file.data();
+		uint8_t sum = 0;
+		for(size_t c = std::min(bytes, file.size()), i = 0; i < c; i += 4096) sum += p[i];
+		volatile uint8_t sink = sum; (void)sink;
+	}
+public:
+	FileBatch()
+	{
+	}
+	FileBatch(const FileBatch&) = delete;
+	FileBatch& operator=(const FileBatch&) = delete;
+	// opens the files in parallel on the pool, or one after another without it, and waits for all of them.
+	// not to be called while the files of the batch are being taken.
+	// returns the number of bytes of the files opened
+	uint64_t open(const FileSource& source, const std::vector<std::string>& names, size_t headerbytes, ThreadPool* pool)
+	{
+		std::vector<ENTRY*> entries;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for(const std::string& name : names) entries.push_back(&mEntries[name]);
+		}
+		auto openentry = [&source, headerbytes](ENTRY* ent, const std::string& name)
+		{
+			try
+			{
+				ent->file = source.open(name);
+				touch(ent->file, headerbytes);
+				ent->opened = true;
+			}
+			catch(std::exception&)
+			{
+				ent->opened = false;
+			}
+		};
+		if(pool && (1 < names.size()))
+		{
+			ThreadPool::Group group;
+			for(size_t cn = names.size(), in = 0; in < cn; in ++) pool->submit(group, [&, in]() { openentry(entries[in], names[in]); });
+			pool->wait(group);
+		}
+		else
+		{
+			for(size_t cn = names.size(), in = 0; in < cn; in ++) openentry(entries[in], names[in]);
+		}
+		uint64_t bytes = 0;
+		for(const ENTRY* ent : entries) if(ent->opened) bytes += ent->file.size();
+		return bytes;
+	}
+	// the file stays in the batch, nullptr if it is not there
+	const FileSource::File* find(const std::string& name) const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(name);
+		return ((it != mEntries.end()) && it->second.opened) ? &it->second.file : nullptr;
+	}
+	// moves the file out of the batch, false if it is not there
+	bool take(const std::string& name, FileSource::File* file)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mEntries.find(name);
+		if((it == mEntries.end()) || !it->second.opened) return false;
+		*file = std::move(it->second.file);
+		it->second.opened = false;
+		return true;
+	}
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mEntries.clear();
+	}
+};
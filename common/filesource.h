@@ -0,0 +1,176 @@
+//
+//  filesource.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "fatimage.h"
+
+// the files of a directory or of a diskette image, by name, or of either held in memory by the caller
+class FileSource
+{
+public:
+	struct ENTRY
+	{
+		std::string name;
+		uintmax_t size;
+	};
+	// a block of memory owned by the caller
+	struct SPAN
+	{
+		const uint8_t* data;
+		size_t size;
+	};
+	// the content of a file, mapped from the directory or pointing into the image or the memory
+	class File
+	{
+	protected:
+		std::unique_ptr<MappedFile> mFile;
+		std::vector<uint8_t> mBuffer;
+		const uint8_t* mData;
+		size_t mSize;
+		friend class FileSource;
+	public:
+		File() : mData(nullptr), mSize(0)
+		{
+		}
+		const uint8_t* data() const
+		{
+			return mData;
+		}
+		size_t size() const
+		{
+			return mSize;
+		}
+	};
+protected:
+	std::filesystem::path mPath;
+	std::unique_ptr<FATImage> mImage;
+	std::map<std::string, SPAN> mFiles;
+	bool mInMemory;
+public:
+	// path: a directory, or an image file as told by FATImage::isImageFile
+	FileSource(const std::filesystem::path& path) : mPath(path), mInMemory(false)
+	{
+		if(!std::filesystem::is_directory(path)) mImage.reset(new FATImage(path));
+	}
+	// the files of a bank in memory by name, which must outlive the source
+	FileSource(const std::map<std::string, SPAN>& files) : mFiles(files), mInMemory(true)
+	{
+	}
+	// a diskette image in memory, which must outlive the source
+	FileSource(const SPAN& image) : mImage(new FATImage(image.data, image.size)), mInMemory(true)
+	{
+	}
+	bool isImage() const
+	{
+		return mImage != nullptr;
+	}
+	bool isInMemory() const
+	{
+		return mInMemory;
+	}
+	const std::filesystem::path& getPath() const
+	{
+		return mPath;
+	}
+	// the regular files, unordered
+	std::vector<ENTRY> list() const
+	{
+		std::vector<ENTRY> entries;
+		if(mImage)
+		{
+			for(const FATImage::ENTRY& ent : mImage->getEntries()) entries.push_back({ ent.name, ent.size });
+		}
+		else if(mInMemory)
+		{
+			for(const auto& it : mFiles) entries.push_back({ it.first, it.second.size });
+		}
+		else
+		{
+			for(const auto& ent : std::filesystem::directory_iterator(mPath))
+			{
+				std::error_code ec;
+				if(!ent.is_regular_file(ec)) continue;
+				uintmax_t size = ent.file_size(ec);
+				entries.push_back({ ent.path().filename().string(), ec ? 0 : size });
+			}
+		}
+		return entries;
+	}
+	bool exists(const std::string& name) const
+	{
+		if(mImage) return mImage->find(name) != nullptr;
+		if(mInMemory) return mFiles.find(name) != mFiles.end();
+		return std::filesystem::is_regular_file(mPath / name);
+	}
+	// the size and the modification time of a file, the time is that of the image file for a file on an image,
+	// and 0 for a file in memory
+	bool stat(const std::string& name, uintmax_t* size, int64_t* mtime) const
+	{
+		std::error_code ec;
+		if(mImage)
+		{
+			const FATImage::ENTRY* ent = mImage->find(name);
+			if(!ent) return false;
+			*size = ent->size;
+		}
+		else if(mInMemory)
+		{
+			auto it = mFiles.find(name);
+			if(it == mFiles.end()) return false;
+			*size = it->second.size;
+		}
+		else
+		{
+			*size = std::filesystem::file_size(mPath / name, ec);
+			if(ec) return false;
+		}
+		if(mInMemory)
+		{
+			*mtime = 0;
+			return true;
+		}
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(mImage ? mPath : (mPath / name), ec);
+		if(ec) return false;
+		*mtime = (int64_t)time.time_since_epoch().count();
+		return true;
+	}
+	// throws on failure
+	File open(const std::string& name) const
+	{
+		File file;
+		if(mImage)
+		{
+			const FATImage::ENTRY* ent = mImage->find(name);
+			if(!ent) throw std::runtime_error("failed to open: \"" + name + "\"");
+			file.mData = mImage->getFileData(*ent, file.mBuffer);
+			file.mSize = ent->size;
+		}
+		else if(mInMemory)
+		{
+			auto it = mFiles.find(name);
+			if(it == mFiles.end()) throw std::runtime_error("failed to open: \"" + name + "\"");
+			file.mData = it->second.data;
+			file.mSize = it->second.size;
+		}
+		else
+		{
+			file.mFile.reset(new MappedFile(mPath / name));
+			file.mData = file.mFile->data();
+			file.mSize = file.mFile->size();
+		}
+		return file;
+	}
+};
@@ -0,0 +1,645 @@
+//
+//  flacencoder.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "cpufeatures.h"
+
+// FLAC stream of mono 16-bit or 24-bit samples, without any external library.
+// the samples are cut into blocks of BlockSize, and the subframe of each block is the smallest of constant, verbatim,
+// fixed and LPC prediction, the residual in partitioned Rice codes. the low bits that are zero throughout a block are
+// removed first (wasted bits), so that the 4 always-zero bits of the 12-bit TX16W samples cost nothing.
+// the autocorrelation of the LPC analysis runs in vectors, as the dot products of the resampler.
+// the stream stays within the streamable subset: 4096 samples per block, up to 12 LPC coefficients and partition order 8.
+class FlacEncoder
+{
+public:
+	enum
+	{
+		BlockSize = 4096,
+		MaxFixedOrder = 4,
+		MaxLPCOrder = 12,
+		MaxPartitionOrder = 8,
+	};
+	using DotKernel = float(*)(const float* a, const float* b, size_t n);
+	// a metadata block after STREAMINFO, e.g. "riff" with a chunk of a WAV file as flac --keep-foreign-metadata does
+	struct APPLICATION
+	{
+		char id[4];
+		std::vector<uint8_t> data;
+	};
+protected:
+	// MSB first, into a byte vector
+	class BitWriter
+	{
+	protected:
+		std::vector<uint8_t>& mOut;
+		uint64_t mAcc;
+		int mBits;
+	public:
+		BitWriter(std::vector<uint8_t>& out) : mOut(out), mAcc(0), mBits(0)
+		{
+		}
+		// bits: 0~32
+		void put(uint32_t v, int bits)
+		{
+			if(bits == 0) return;
+			mAcc = (mAcc << bits) | (v & (uint32_t)((1ull << bits) - 1));
+			mBits += bits;
+			while(8 <= mBits)
+			{
+				mBits -= 8;
+				mOut.push_back((uint8_t)(mAcc >> mBits));
+			}
+		}
+		void putSigned(int32_t v, int bits)
+		{
+			put((uint32_t)v, bits);
+		}
+		// q zeros and a one
+		void putUnary(uint32_t q)
+		{
+			for(; 32 <= q; q -= 32) put(0, 32);
+			put(1, (int)q + 1);
+		}
+		void putRice(int32_t e, int k)
+		{
+			uint32_t u = ((uint32_t)e << 1) ^ (uint32_t)(e >> 31);
+			uint32_t q = u >> k;
+			if(q + 1 + k <= 32) put((1u << k) | (u & ((1u << k) - 1)), (int)q + 1 + k);
+			else
+			{
+				putUnary(q);
+				put(u, k);
+			}
+		}
+		// zeros up to the next byte
+		void align()
+		{
+			if(mBits) put(0, 8 - mBits);
+		}
+		size_t getByteCount() const
+		{
+			return mOut.size();
+		}
+	};
+	// the coding of a residual: the partition order and the Rice parameter of each partition
+	struct RICECODING
+	{
+		int order = 0;
+		int params[1 << MaxPartitionOrder] = {};
+		bool rice2 = false;
+		uint64_t bits = UINT64_MAX;
+	};
+	// the working buffers of a block, reused over the blocks
+	struct SCRATCH
+	{
+		std::vector<int32_t> samples, residual, fixedresidual;
+		std::vector<float> windowed, window;
+		std::vector<uint64_t> sums;
+	};
+	static const uint8_t* getCRC8Table()
+	{
+		static const std::vector<uint8_t> table = []()
+		{
+			std::vector<uint8_t> t(256);
+			for(int i = 0; i < 256; i ++)
+			{
+				uint8_t c = (uint8_t)i;
+				for(int b = 0; b < 8; b ++) c = (uint8_t)((c & 0x80) ? ((c << 1) ^ 0x07) : (c << 1));
+				t[i] = c;
+			}
+			return t;
+		}();
+		return table.data();
+	}
+	static const uint16_t* getCRC16Table()
+	{
+		static const std::vector<uint16_t> table = []()
+		{
+			std::vector<uint16_t> t(256);
+			for(int i = 0; i < 256; i ++)
+			{
+				uint16_t c = (uint16_t)(i << 8);
+				for(int b = 0; b < 8; b ++) c = (uint16_t)((c & 0x8000) ? ((c << 1) ^ 0x8005) : (c << 1));
+				t[i] = c;
+			}
+			return t;
+		}();
+		return table.data();
+	}
+	static uint8_t crc8(const uint8_t* p, size_t c)
+	{
+		const uint8_t* t = getCRC8Table();
+		uint8_t crc = 0;
+		for(size_t i = 0; i < c; i ++) crc = t[crc ^ p[i]];
+		return crc;
+	}
+	static uint16_t crc16(const uint8_t* p, size_t c)
+	{
+		const uint16_t* t = getCRC16Table();
+		uint16_t crc = 0;
+		for(size_t i = 0; i < c; i ++) crc = (uint16_t)((crc << 8) ^ t[(crc >> 8) ^ p[i]]);
+		return crc;
+	}
+	// ================================================================================
+	// residual coding
+
+	// the smallest Rice coding of the residual of a block of n samples, which starts after the warm-up samples
+	static RICECODING chooseRiceCoding(const int32_t* residual, uint32_t n, int order, std::vector<uint64_t>& sums)
+	{
+		int maxorder = 0;
+		while((maxorder < MaxPartitionOrder) && ((n & ((2u << maxorder) - 1)) == 0) && ((int)(n >> (maxorder + 1)) > order)) maxorder ++;
+		// the sums of the zigzag values of the finest partitions, then merged in pairs for the coarser ones
+		uint32_t numparts = 1u << maxorder, partsize = n >> maxorder;
+		sums.assign(numparts, 0);
+		for(uint32_t ip = 0, i = 0; ip < numparts; ip ++)
+		{
+			uint32_t end = (ip + 1) * partsize - order;
+			uint64_t sum = 0;
+			for(; i < end; i ++) sum += ((uint32_t)residual[i] << 1) ^ (uint32_t)(residual[i] >> 31);
+			sums[ip] = sum;
+		}
+		RICECODING best;
+		for(int porder = maxorder; 0 <= porder; porder --)
+		{
+			RICECODING rc;
+			rc.order = porder;
+			uint64_t bits = 2 + 4;
+			uint32_t np = 1u << porder, ps = n >> porder;
+			for(uint32_t ip = 0; ip < np; ip ++)
+			{
+				uint64_t count = (ip == 0) ? (ps - order) : ps;
+				int k = 0;
+				uint64_t partbits = count;
+				if(count)
+				{
+					// around the log2 of the mean
+					uint64_t mean = sums[ip] / count;
+					int k0 = 0;
+					while((k0 < 30) && ((2ull << k0) <= mean)) k0 ++;
+					partbits = UINT64_MAX;
+					for(int kk = std::max(0, k0 - 1); kk <= std::min(30, k0 + 1); kk ++)
+					{
+						uint64_t b = count * (uint64_t)(kk + 1) + (sums[ip] >> kk);
+						if(b < partbits) { partbits = b; k = kk; }
+					}
+				}
+				rc.params[ip] = k;
+				if(14 < k) rc.rice2 = true;
+				bits += partbits;
+			}
+			bits += (uint64_t)np * (rc.rice2 ? 5 : 4);
+			rc.bits = bits;
+			if(rc.bits < best.bits) best = rc;
+			// merge in pairs for the next coarser order
+			for(uint32_t ip = 0; ip < np / 2; ip ++) sums[ip] = sums[ip * 2] + sums[ip * 2 + 1];
+		}
+		return best;
+	}
+	static void writeResidual(BitWriter& bw, const int32_t* residual, uint32_t n, int order, const RICECODING& rc)
+	{
+		bw.put(rc.rice2 ? 1 : 0, 2);
+		bw.put((uint32_t)rc.order, 4);
+		uint32_t np = 1u << rc.order, ps = n >> rc.order;
+		for(uint32_t ip = 0, i = 0; ip < np; ip ++)
+		{
+			int k = rc.params[ip];
+			bw.put((uint32_t)k, rc.rice2 ? 5 : 4);
+			uint32_t end = (ip + 1) * ps - order;
+			for(; i < end; i ++) bw.putRice(residual[i], k);
+		}
+	}
+	// ================================================================================
+	// prediction
+
+	// the order of the smallest sum of the absolute residuals, and its residual
+	static int computeFixedResidual(const int32_t* x, uint32_t n, int32_t* residual)
+	{
+		uint64_t sums[MaxFixedOrder + 1] = {};
+		for(uint32_t i = MaxFixedOrder; i < n; i ++)
+		{
+			int64_t e0 = x[i];
+			int64_t e1 = e0 - x[i - 1];
+			int64_t e2 = e1 - (x[i - 1] - (int64_t)x[i - 2]);
+			int64_t e3 = e2 - (x[i - 1] - 2 * (int64_t)x[i - 2] + x[i - 3]);
+			int64_t e4 = e3 - (x[i - 1] - 3 * (int64_t)x[i - 2] + 3 * (int64_t)x[i - 3] - x[i - 4]);
+			sums[0] += (uint64_t)std::llabs(e0);
+			sums[1] += (uint64_t)std::llabs(e1);
+			sums[2] += (uint64_t)std::llabs(e2);
+			sums[3] += (uint64_t)std::llabs(e3);
+			sums[4] += (uint64_t)std::llabs(e4);
+		}
+		int order = 0;
+		for(int o = 1; o <= MaxFixedOrder; o ++) if(sums[o] < sums[order]) order = o;
+		for(uint32_t i = order; i < n; i ++)
+		{
+			int64_t e;
+			switch(order)
+			{
+				case 0: e = x[i]; break;
+				case 1: e = (int64_t)x[i] - x[i - 1]; break;
+				case 2: e = (int64_t)x[i] - 2 * (int64_t)x[i - 1] + x[i - 2]; break;
+				case 3: e = (int64_t)x[i] - 3 * (int64_t)x[i - 1] + 3 * (int64_t)x[i - 2] - x[i - 3]; break;
+				default: e = (int64_t)x[i] - 4 * (int64_t)x[i - 1] + 6 * (int64_t)x[i - 2] - 4 * (int64_t)x[i - 3] + x[i - 4]; break;
+			}
+			residual[i - order] = (int32_t)e;
+		}
+		return order;
+	}
+	// quantized LPC coefficients from the windowed autocorrelation, false if the block is not worth the prediction
+	static bool computeLPC(const int32_t* x, uint32_t n, uint32_t bps, SCRATCH& s, int* order, int32_t* qcoefs, int* precision, int* shift)
+	{
+		static const DotKernel dot = getDotKernel(CpuFeatures::getLevel());
+		int maxorder = std::min<int>(MaxLPCOrder, (int)n / 4);
+		if(maxorder < 1) return false;
+		// tukey(0.5) window, kept for the full blocks
+		if(s.window.size() != n)
+		{
+			const double pi = 3.14159265358979323846;
+			s.window.assign(n, 1.0f);
+			uint32_t taper = n / 4;
+			for(uint32_t i = 0; i < taper; i ++)
+			{
+				float w = (float)(0.5 - 0.5 * std::cos(pi * i / taper));
+				s.window[i] = w;
+				s.window[n - 1 - i] = w;
+			}
+		}
+		s.windowed.resize(n);
+		for(uint32_t i = 0; i < n; i ++) s.windowed[i] = (float)x[i] * s.window[i];
+		double r[MaxLPCOrder + 1];
+		for(int l = 0; l <= maxorder; l ++) r[l] = dot(s.windowed.data(), s.windowed.data() + l, n - l);
+		if(r[0] <= 0) return false;
+		// levinson-durbin, the coefficients and the error of every order
+		double lpc[MaxLPCOrder] = {}, coefs[MaxLPCOrder][MaxLPCOrder] = {}, errors[MaxLPCOrder] = {};
+		double err = r[0];
+		int numorders = 0;
+		for(int i = 0; i < maxorder; i ++)
+		{
+			double acc = -r[i + 1];
+			for(int j = 0; j < i; j ++) acc -= lpc[j] * r[i - j];
+			double k = acc / err;
+			lpc[i] = k;
+			int j = 0;
+			for(; j < (i >> 1); j ++)
+			{
+				double t = lpc[j];
+				lpc[j] += k * lpc[i - 1 - j];
+				lpc[i - 1 - j] += k * t;
+			}
+			if(i & 1) lpc[j] += lpc[j] * k;
+			err *= 1.0 - k * k;
+			for(j = 0; j <= i; j ++) coefs[i][j] = -lpc[j];
+			errors[i] = err;
+			numorders = i + 1;
+			if(err <= 0) break;
+		}
+		if(numorders == 0) return false;
+		// the order of the fewest expected bits, the residual of each sample as 0.5*log2(error/n)
+		*precision = (bps <= 16) ? 12 : 15;
+		int bestorder = 1;
+		double bestbits = 1e300;
+		for(int o = 1; o <= numorders; o ++)
+		{
+			double bitspersample = (0 < errors[o - 1]) ? std::max(0.0, 0.5 * std::log2(0.5 * errors[o - 1] / n)) : 0.0;
+			double bits = bitspersample * (n - o) + o * (double)(bps + *precision);
+			if(bits < bestbits) { bestbits = bits; bestorder = o; }
+		}
+		*order = bestorder;
+		// quantized in the precision with the error carried over
+		const double* c = coefs[bestorder - 1];
+		double cmax = 0;
+		for(int j = 0; j < bestorder; j ++) cmax = std::max(cmax, std::fabs(c[j]));
+		if(cmax <= 0) return false;
+		int log2cmax;
+		std::frexp(cmax, &log2cmax);
+		int sh = *precision - 1 - log2cmax;
+		if(sh < 0) return false;
+		*shift = std::min(sh, 15);
+		int32_t qmax = (1 << (*precision - 1)) - 1, qmin = -(1 << (*precision - 1));
+		double qerr = 0;
+		for(int j = 0; j < bestorder; j ++)
+		{
+			double v = c[j] * (double)(1 << *shift) + qerr;
+			int32_t q = std::clamp((int32_t)std::lround(v), qmin, qmax);
+			qerr = v - q;
+			qcoefs[j] = q;
+		}
+		return true;
+	}
+	// false if a residual overflows
+	static bool computeLPCResidual(const int32_t* x, uint32_t n, int order, const int32_t* qcoefs, int shift, int32_t* residual)
+	{
+		for(uint32_t i = order; i < n; i ++)
+		{
+			int64_t sum = 0;
+			for(int j = 0; j < order; j ++) sum += (int64_t)qcoefs[j] * x[i - 1 - j];
+			int64_t e = (int64_t)x[i] - (sum >> shift);
+			if((e < -(1ll << 30)) || ((1ll << 30) < e)) return false;
+			residual[i - order] = (int32_t)e;
+		}
+		return true;
+	}
+	// ================================================================================
+	// frames
+
+	static uint32_t getSampleRateCode(uint32_t samplerate, uint32_t* extra, int* extrabits)
+	{
+		static const uint32_t rates[] = { 0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000 };
+		*extrabits = 0;
+		for(uint32_t i = 1; i < std::size(rates); i ++) if(rates[i] == samplerate) return i;
+		if((samplerate % 1000 == 0) && (samplerate / 1000 <= 255)) { *extra = samplerate / 1000; *extrabits = 8; return 12; }
+		if(samplerate <= 65535) { *extra = samplerate; *extrabits = 16; return 13; }
+		if((samplerate % 10 == 0) && (samplerate / 10 <= 65535)) { *extra = samplerate / 10; *extrabits = 16; return 14; }
+		return 0; // from STREAMINFO
+	}
+	static void writeFrameHeader(BitWriter& bw, std::vector<uint8_t>& out, uint32_t n, uint32_t bps, uint32_t samplerate, uint64_t framenumber)
+	{
+		size_t start = out.size();
+		bw.put(0xfff8, 16); // sync, fixed block size
+		bool fullblock = n == BlockSize;
+		bw.put(fullblock ? 12 : 7, 4); // 4096, or 16 bits of n - 1 at the end
+		uint32_t rateextra = 0;
+		int rateextrabits = 0;
+		bw.put(getSampleRateCode(samplerate, &rateextra, &rateextrabits), 4);
+		bw.put(0, 4); // mono
+		bw.put((bps == 24) ? 6 : 4, 3);
+		bw.put(0, 1);
+		// the frame number in the UTF-8 manner
+		if(framenumber < 0x80) bw.put((uint32_t)framenumber, 8);
+		else
+		{
+			int numbytes = 2;
+			while((numbytes < 7) && ((1ull << (5 * numbytes + 1)) <= framenumber)) numbytes ++;
+			bw.put(((1u << numbytes) - 1) << 1, numbytes + 1);
+			bw.put((uint32_t)(framenumber >> (6 * (numbytes - 1))), 7 - numbytes);
+			for(int i = numbytes - 2; 0 <= i; i --) bw.put(0x80 | (uint32_t)((framenumber >> (6 * i)) & 0x3f), 8);
+		}
+		if(!fullblock) bw.put(n - 1, 16);
+		if(rateextrabits) bw.put(rateextra, rateextrabits);
+		bw.put(crc8(out.data() + start, out.size() - start), 8);
+	}
+	static void writeSubframeHeader(BitWriter& bw, uint32_t type, int wasted)
+	{
+		bw.put(0, 1);
+		bw.put(type, 6);
+		bw.put(wasted ? 1 : 0, 1);
+		if(wasted) bw.putUnary((uint32_t)wasted - 1);
+	}
+	static void writeFrame(BitWriter& bw, std::vector<uint8_t>& out, const int32_t* samples, uint32_t n, uint32_t bps, uint32_t samplerate, uint64_t framenumber, SCRATCH& s)
+	{
+		size_t start = out.size();
+		writeFrameHeader(bw, out, n, bps, samplerate, framenumber);
+		bool constant = true;
+		uint32_t bits = 0;
+		for(uint32_t i = 0; i < n; i ++)
+		{
+			bits |= (uint32_t)samples[i];
+			if(samples[i] != samples[0]) constant = false;
+		}
+		if(constant)
+		{
+			writeSubframeHeader(bw, 0, 0);
+			bw.putSigned(samples[0], (int)bps);
+		}
+		else
+		{
+			// the common zero low bits are shifted out
+			int wasted = 0;
+			while(!(bits & (1u << wasted))) wasted ++;
+			uint32_t ebps = bps - wasted;
+			s.samples.resize(n);
+			int32_t* x = s.samples.data();
+			for(uint32_t i = 0; i < n; i ++) x[i] = samples[i] >> wasted;
+			uint64_t verbatimbits = (uint64_t)n * ebps;
+			// fixed
+			s.fixedresidual.resize(n);
+			int fixedorder = -1;
+			RICECODING fixedrc;
+			if(MaxFixedOrder < n)
+			{
+				fixedorder = computeFixedResidual(x, n, s.fixedresidual.data());
+				fixedrc = chooseRiceCoding(s.fixedresidual.data(), n, fixedorder, s.sums);
+				fixedrc.bits += (uint64_t)fixedorder * ebps;
+			}
+			// lpc
+			s.residual.resize(n);
+			int lpcorder = 0, precision = 0, shift = 0;
+			int32_t qcoefs[MaxLPCOrder] = {};
+			RICECODING lpcrc;
+			if(computeLPC(x, n, ebps, s, &lpcorder, qcoefs, &precision, &shift) && computeLPCResidual(x, n, lpcorder, qcoefs, shift, s.residual.data()))
+			{
+				lpcrc = chooseRiceCoding(s.residual.data(), n, lpcorder, s.sums);
+				lpcrc.bits += (uint64_t)lpcorder * (ebps + precision) + 4 + 5;
+			}
+			if((lpcrc.bits < fixedrc.bits) && (lpcrc.bits < verbatimbits))
+			{
+				writeSubframeHeader(bw, 0x20 | (uint32_t)(lpcorder - 1), wasted);
+				for(int i = 0; i < lpcorder; i ++) bw.putSigned(x[i], (int)ebps);
+				bw.put((uint32_t)precision - 1, 4);
+				bw.putSigned(shift, 5);
+				for(int i = 0; i < lpcorder; i ++) bw.putSigned(qcoefs[i], precision);
+				writeResidual(bw, s.residual.data(), n, lpcorder, lpcrc);
+			}
+			else if((0 <= fixedorder) && (fixedrc.bits < verbatimbits))
+			{
+				writeSubframeHeader(bw, 0x08 | (uint32_t)fixedorder, wasted);
+				for(int i = 0; i < fixedorder; i ++) bw.putSigned(x[i], (int)ebps);
+				writeResidual(bw, s.fixedresidual.data(), n, fixedorder, fixedrc);
+			}
+			else
+			{
+				writeSubframeHeader(bw, 1, wasted);
+				for(uint32_t i = 0; i < n; i ++) bw.putSigned(x[i], (int)ebps);
+			}
+		}
+		bw.align();
+		bw.put(crc16(out.data() + start, out.size() - start), 16);
+	}
+	// ================================================================================
+	// md5 of the samples as they are in the WAV file, cf. RFC 1321
+	static void computeMD5(const uint8_t* p, size_t c, uint8_t digest[16])
+	{
+		static const uint32_t k[64] =
+		{
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+		};
+		static const int r[64] =
+		{
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+		};
+		uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+		auto block = [&](const uint8_t* b)
+		{
+			uint32_t w[16];
+			for(int i = 0; i < 16; i ++) w[i] = (uint32_t)b[i * 4] | ((uint32_t)b[i * 4 + 1] << 8) | ((uint32_t)b[i * 4 + 2] << 16) | ((uint32_t)b[i * 4 + 3] << 24);
+			uint32_t a = h[0], bb = h[1], cc = h[2], d = h[3];
+			for(int i = 0; i < 64; i ++)
+			{
+				uint32_t f;
+				int g;
+				if     (i < 16) { f = (bb & cc) | (~bb & d); g = i; }
+				else if(i < 32) { f = (d & bb) | (~d & cc); g = (5 * i + 1) & 15; }
+				else if(i < 48) { f = bb ^ cc ^ d; g = (3 * i + 5) & 15; }
+				else			{ f = cc ^ (bb | ~d); g = (7 * i) & 15; }
+				uint32_t t = d;
+				d = cc;
+				cc = bb;
+				uint32_t x = a + f + k[i] + w[g];
+				bb = bb + ((x << r[i]) | (x >> (32 - r[i])));
+				a = t;
+			}
+			h[0] += a; h[1] += bb; h[2] += cc; h[3] += d;
+		};
+		size_t i = 0;
+		for(; i + 64 <= c; i += 64) block(p + i);
+		uint8_t tail[128] = {};
+		size_t rest = c - i;
+		if(rest) memcpy(tail, p + i, rest);
+		tail[rest] = 0x80;
+		size_t tailsize = (rest < 56) ? 64 : 128;
+		uint64_t bitlength = (uint64_t)c * 8;
+		for(int j = 0; j < 8; j ++) tail[tailsize - 8 + j] = (uint8_t)(bitlength >> (8 * j));
+		block(tail);
+		if(tailsize == 128) block(tail + 64);
+		for(int j = 0; j < 16; j ++) digest[j] = (uint8_t)(h[j / 4] >> (8 * (j % 4)));
+	}
+public:
+	// the whole stream of mono samples, 16 or 24 bits little endian as in a WAV file, throws on an invalid format
+	static void encode(const uint8_t* data, uint32_t length, uint32_t bitspersample, uint32_t samplerate, const std::vector<APPLICATION>& applications, std::vector<uint8_t>* stream)
+	{
+		if(((bitspersample != 16) && (bitspersample != 24)) || (samplerate == 0) || ((1u << 20) <= samplerate)) throw std::runtime_error("flac: unsupported format");
+		std::vector<uint8_t>& out = *stream;
+		out.clear();
+		out.reserve((size_t)length * bitspersample / 16 + 1024);
+		BitWriter bw(out);
+		bw.put(0x664C6143, 32); // "fLaC"
+		// STREAMINFO, the frame sizes are filled in at the end
+		bw.put(applications.empty() ? 0x80 : 0x00, 8);
+		bw.put(34, 24);
+		size_t streaminfo = out.size();
+		bw.put(BlockSize, 16);
+		bw.put(BlockSize, 16);
+		bw.put(0, 24);
+		bw.put(0, 24);
+		bw.put(samplerate, 20);
+		bw.put(0, 3); // mono
+		bw.put(bitspersample - 1, 5);
+		bw.put((uint32_t)((uint64_t)length >> 32), 4);
+		bw.put(length, 32);
+		uint8_t md5[16];
+		computeMD5(data, (size_t)length * (bitspersample / 8), md5);
+		for(uint8_t b : md5) bw.put(b, 8);
+		for(size_t ca = applications.size(), ia = 0; ia < ca; ia ++)
+		{
+			const APPLICATION& app = applications[ia];
+			bw.put((ia + 1 == ca) ? 0x82 : 0x02, 8);
+			bw.put((uint32_t)(4 + app.data.size()), 24);
+			for(char c : app.id) bw.put((uint8_t)c, 8);
+			out.insert(out.end(), app.data.begin(), app.data.end());
+		}
+		// frames
+		SCRATCH s;
+		std::vector<int32_t> samples(BlockSize);
+		uint32_t minframe = UINT32_MAX, maxframe = 0;
+		uint32_t bytespersample = bitspersample / 8;
+		for(uint32_t pos = 0, frame = 0; pos < length; pos += BlockSize, frame ++)
+		{
+			uint32_t n = std::min<uint32_t>(BlockSize, length - pos);
+			const uint8_t* src = data + (size_t)pos * bytespersample;
+			if(bitspersample == 16)
+			{
+				for(uint32_t i = 0; i < n; i ++) samples[i] = (int16_t)((uint16_t)src[i * 2] | ((uint16_t)src[i * 2 + 1] << 8));
+			}
+			else
+			{
+				for(uint32_t i = 0; i < n; i ++) samples[i] = (int32_t)(((uint32_t)src[i * 3] << 8) | ((uint32_t)src[i * 3 + 1] << 16) | ((uint32_t)src[i * 3 + 2] << 24)) >> 8;
+			}
+			size_t start = out.size();
+			writeFrame(bw, out, samples.data(), n, bitspersample, samplerate, frame, s);
+			uint32_t framesize = (uint32_t)(out.size() - start);
+			minframe = std::min(minframe, framesize);
+			maxframe = std::max(maxframe, framesize);
+		}
+		if(length == 0) minframe = 0;
+		for(int i = 0; i < 3; i ++)
+		{
+			out[streaminfo + 4 + i] = (uint8_t)(minframe >> (16 - 8 * i));
+			out[streaminfo + 7 + i] = (uint8_t)(maxframe >> (16 - 8 * i));
+		}
+	}
+	// ================================================================================
+	// autocorrelation kernels
+	static float dotScalar(const float* a, const float* b, size_t n)
+	{
+		float sum = 0;
+		for(size_t i = 0; i < n; i ++) sum += a[i] * b[i];
+		return sum;
+	}
+#if TXW_X86
+	TXW_TARGET_SSE2 static float dotSSE2(const float* a, const float* b, size_t n)
+	{
+		__m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+		size_t i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i + 0), _mm_loadu_ps(b + i + 0)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		__m128 s = _mm_add_ps(s0, s1);
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		float sum = _mm_cvtss_f32(s);
+		for(; i < n; i ++) sum += a[i] * b[i];
+		return sum;
+	}
+	TXW_TARGET_AVX2 static float dotAVX2(const float* a, const float* b, size_t n)
+	{
+		__m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+		size_t i = 0;
+		for(; i + 16 <= n; i += 16)
+		{
+			s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i + 0), _mm256_loadu_ps(b + i + 0)));
+			s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+		}
+		__m256 s8 = _mm256_add_ps(s0, s1);
+		__m128 s = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		float sum = _mm_cvtss_f32(s);
+		for(; i < n; i ++) sum += a[i] * b[i];
+		return sum;
+	}
+#endif
+	static DotKernel getDotKernel(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return dotAVX2;
+		if(level == CpuFeatures::LevelSSE2) return dotSSE2;
+#endif
+		return dotScalar;
+	}
+};
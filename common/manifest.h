@@ -0,0 +1,191 @@
+//
+//  manifest.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "contenthash.h"
+#include "filesource.h"
+
+// the inputs each unit of outputs was converted from, kept in a text file in the output directory across runs.
+// a unit is up to date if it was converted by the same version with the same options, all of its outputs exist,
+// and each of its inputs has the same size, and the same modification time or else the same content hash.
+// the names of the units and of the outputs are relative to the output directory.
+class BuildManifest
+{
+public:
+	struct INPUT
+	{
+		std::string name;
+		uintmax_t size;
+		int64_t mtime;
+		ContentHash hash;
+	};
+	struct UNIT
+	{
+		std::string version;
+		std::string options;
+		std::vector<INPUT> inputs;
+		std::vector<std::string> outputs;
+	};
+protected:
+	std::filesystem::path mDir;
+	std::filesystem::path mPath;
+	std::mutex mMutex;
+	std::map<std::string, UNIT> mUnits;
+	bool mModified;
+	static std::vector<std::string> split(const std::string& line)
+	{
+		std::vector<std::string> fields;
+		std::istringstream str(line);
+		std::string field;
+		while(std::getline(str, field, '\t')) fields.push_back(field);
+		return fields;
+	}
+	// a broken manifest is discarded, then everything is converted again
+	void load()
+	{
+		std::ifstream str(mPath);
+		if(!str) return;
+		std::string line;
+		if(!std::getline(str, line) || (line != "txwmanifest\t1")) return;
+		UNIT* unit = nullptr;
+		while(std::getline(str, line))
+		{
+			std::vector<std::string> fields = split(line);
+			if((fields.size() == 4) && (fields[0] == "unit"))
+			{
+				unit = &mUnits[fields[1]];
+				*unit = { fields[2], fields[3], {}, {} };
+			}
+			else if(unit && (fields.size() == 5) && (fields[0] == "in"))
+			{
+				INPUT input = { fields[1], std::strtoull(fields[2].c_str(), nullptr, 10), std::strtoll(fields[3].c_str(), nullptr, 10), {} };
+				if(!ContentHash::fromString(fields[4], &input.hash)) { mUnits.clear(); return; }
+				unit->inputs.push_back(input);
+			}
+			else if(unit && (fields.size() == 2) && (fields[0] == "out"))
+			{
+				unit->outputs.push_back(fields[1]);
+			}
+			else
+			{
+				mUnits.clear();
+				return;
+			}
+		}
+	}
+public:
+	BuildManifest(const std::filesystem::path& dir, const std::string& filename) : mDir(dir), mPath(dir / filename), mModified(false)
+	{
+		load();
+	}
+	BuildManifest(const BuildManifest&) = delete;
+	BuildManifest& operator=(const BuildManifest&) = delete;
+	const std::filesystem::path& getPath() const
+	{
+		return mPath;
+	}
+	// the name of a unit or an output path in the manifest
+	std::string getRelativeName(const std::filesystem::path& path) const
+	{
+		return path.lexically_relative(mDir).generic_string();
+	}
+	// throws on failure
+	static INPUT scanInput(const FileSource& source, const std::string& name)
+	{
+		INPUT input = { name, 0, 0, {} };
+		if(!source.stat(name, &input.size, &input.mtime)) throw std::runtime_error("failed to open: \"" + name + "\"");
+		FileSource::File file = source.open(name);
+		input.hash = ContentHash::compute(file.data(), file.size());
+		return input;
+	}
+	// the contents are hashed only for the inputs whose modification time has changed
+	bool isUpToDate(const std::string& key, const std::string& version, const std::string& options, const FileSource& source)
+	{
+		UNIT unit;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto it = mUnits.find(key);
+			if(it == mUnits.end()) return false;
+			unit = it->second;
+		}
+		if((unit.version != version) || (unit.options != options)) return false;
+		for(const std::string& output : unit.outputs)
+		{
+			std::error_code ec;
+			if(!std::filesystem::is_regular_file(mDir / output, ec)) return false;
+		}
+		bool touched = false;
+		for(INPUT& input : unit.inputs)
+		{
+			uintmax_t size = 0;
+			int64_t mtime = 0;
+			if(!source.stat(input.name, &size, &mtime) || (size != input.size)) return false;
+			if(mtime == input.mtime) continue;
+			try
+			{
+				FileSource::File file = source.open(input.name);
+				if(!(ContentHash::compute(file.data(), file.size()) == input.hash)) return false;
+			}
+			catch(std::exception&)
+			{
+				return false;
+			}
+			// the same content, the new time saves the hashing next time
+			input.mtime = mtime;
+			touched = true;
+		}
+		if(touched) update(key, unit);
+		return true;
+	}
+	void update(const std::string& key, const UNIT& unit)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mUnits[key] = unit;
+		mModified = true;
+	}
+	// records the unit with the current state of its inputs, throws on failure
+	void update(const std::string& key, const std::string& version, const std::string& options, const FileSource& source, const std::vector<std::string>& inputnames, const std::vector<std::filesystem::path>& outputs)
+	{
+		UNIT unit = { version, options, {}, {} };
+		for(const std::string& name : inputnames) unit.inputs.push_back(scanInput(source, name));
+		for(const std::filesystem::path& output : outputs) unit.outputs.push_back(getRelativeName(output));
+		update(key, unit);
+	}
+	// written aside and renamed, so that an interrupted run leaves the previous manifest
+	void save()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(!mModified) return;
+		std::filesystem::path tmppath = mPath;
+		tmppath += ".tmp";
+		{
+			std::ofstream str(tmppath, std::ios::out | std::ios::trunc);
+			if(!str) throw std::runtime_error("failed to create: \"" + tmppath.filename().string() + "\"");
+			str.exceptions(std::ios::badbit | std::ios::eofbit | std::ios::failbit);
+			str << "txwmanifest\t1\n";
+			for(const auto& it : mUnits)
+			{
+				const UNIT& unit = it.second;
+				str << "unit\t" << it.first << "\t" << unit.version << "\t" << unit.options << "\n";
+				for(const INPUT& input : unit.inputs) str << "in\t" << input.name << "\t" << input.size << "\t" << input.mtime << "\t" << input.hash.toString() << "\n";
+				for(const std::string& output : unit.outputs) str << "out\t" << output << "\n";
+			}
+		}
+		std::filesystem::rename(tmppath, mPath);
+		mModified = false;
+	}
+};
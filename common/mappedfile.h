@@ -0,0 +1,95 @@
+//
+//  mappedfile.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <filesystem>
+#include <stdexcept>
+
+#if defined _WIN32
+#if !defined WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only view of a whole file
+class MappedFile
+{
+protected:
+	const uint8_t* mData;
+	size_t mSize;
+#if defined _WIN32
+	HANDLE mFile, mMapping;
+#endif
+public:
+	MappedFile(const std::filesystem::path& path) : mData(nullptr), mSize(0)
+	{
+#if defined _WIN32
+		mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(mFile == INVALID_HANDLE_VALUE) throw std::runtime_error("failed to open: \"" + path.filename().string() + "\"");
+		mMapping = nullptr;
+		LARGE_INTEGER li = {};
+		GetFileSizeEx(mFile, &li);
+		mSize = (size_t)li.QuadPart;
+		if(mSize == 0) return;
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mMapping) mData = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+		if(!mData) { close(); throw std::runtime_error("failed to map: \"" + path.filename().string() + "\""); }
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0) throw std::runtime_error("failed to open: \"" + path.filename().string() + "\"");
+		struct stat st = {};
+		if(::fstat(fd, &st) != 0) { ::close(fd); throw std::runtime_error("failed to open: \"" + path.filename().string() + "\""); }
+		mSize = (size_t)st.st_size;
+		if(mSize == 0) { ::close(fd); return; }
+		void* p = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if(p == MAP_FAILED) { mSize = 0; throw std::runtime_error("failed to map: \"" + path.filename().string() + "\""); }
+		::madvise(p, mSize, MADV_SEQUENTIAL);
+		mData = (const uint8_t*)p;
+#endif
+	}
+	~MappedFile()
+	{
+		close();
+	}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	const uint8_t* data() const
+	{
+		return mData;
+	}
+	size_t size() const
+	{
+		return mSize;
+	}
+private:
+	void close()
+	{
+#if defined _WIN32
+		if(mData) UnmapViewOfFile(mData);
+		if(mMapping) CloseHandle(mMapping);
+		if(mFile != INVALID_HANDLE_VALUE) CloseHandle(mFile);
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+#else
+		if(mData) ::munmap((void*)mData, mSize);
+#endif
+		mData = nullptr;
+		mSize = 0;
+	}
+};
@@ -0,0 +1,160 @@
+//
+//  outputsink.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+
+// the destination of the converted files, by name.
+// each file is written whole from its parts, so that a wave goes out without copying its samples.
+// the writes of different names may come from concurrent tasks.
+class OutputSink
+{
+public:
+	struct SPAN
+	{
+		const void* data;
+		size_t size;
+	};
+	virtual ~OutputSink()
+	{
+	}
+	virtual bool exists(const std::string& name) const = 0;
+	// text: the native line ends where the sink makes a difference, throws on failure
+	virtual void write(const std::string& name, const SPAN* parts, size_t count, bool text) = 0;
+	void write(const std::string& name, const void* p, size_t c, bool text)
+	{
+		SPAN part = { p, c };
+		write(name, &part, 1, text);
+	}
+	// the content of an existing file, e.g. from the sample store, a sink may link it instead of copying
+	virtual void writeFrom(const std::string& name, const std::filesystem::path& path)
+	{
+		MappedFile file(path);
+		write(name, file.data(), file.size(), false);
+	}
+};
+
+// the files of a directory, which must exist
+class DirectorySink : public OutputSink
+{
+protected:
+	std::filesystem::path mDir;
+public:
+	DirectorySink(const std::filesystem::path& dir) : mDir(dir)
+	{
+	}
+	const std::filesystem::path& getDirectory() const
+	{
+		return mDir;
+	}
+	std::filesystem::path getPath(const std::string& name) const
+	{
+		return mDir / name;
+	}
+	virtual bool exists(const std::string& name) const override
+	{
+		return std::filesystem::exists(getPath(name));
+	}
+	using OutputSink::write;
+	virtual void write(const std::string& name, const SPAN* parts, size_t count, bool text) override
+	{
+		std::filesystem::path path = getPath(name);
+		// never write through a hard link into a shared sample
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		std::ofstream str(path, text ? (std::ios::out | std::ios::trunc) : (std::ios::out | std::ios::binary | std::ios::trunc));
+		if(!str) throw std::runtime_error("failed to create: \"" + path.filename().string() + "\"");
+		for(size_t i = 0; i < count; i ++) str.write((const char*)parts[i].data, (std::streamsize)parts[i].size);
+		if(!str.flush()) throw std::runtime_error("failed to write: \"" + path.filename().string() + "\"");
+	}
+	// a hard link, or a copy where links are not supported
+	virtual void writeFrom(const std::string& name, const std::filesystem::path& srcpath) override
+	{
+		std::filesystem::path path = getPath(name);
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		std::filesystem::create_hard_link(srcpath, path, ec);
+		if(ec) std::filesystem::copy_file(srcpath, path, std::filesystem::copy_options::overwrite_existing);
+	}
+};
+
+// the files of another sink under a prefix, e.g. a bank in its subdirectory of an archive
+class PrefixedSink : public OutputSink
+{
+protected:
+	OutputSink& mSink;
+	std::string mPrefix;
+public:
+	// prefix: "dir/" or empty, the sink must outlive this
+	PrefixedSink(OutputSink& sink, const std::string& prefix) : mSink(sink), mPrefix(prefix)
+	{
+	}
+	virtual bool exists(const std::string& name) const override
+	{
+		return mSink.exists(mPrefix + name);
+	}
+	using OutputSink::write;
+	virtual void write(const std::string& name, const SPAN* parts, size_t count, bool text) override
+	{
+		mSink.write(mPrefix + name, parts, count, text);
+	}
+	virtual void writeFrom(const std::string& name, const std::filesystem::path& path) override
+	{
+		mSink.writeFrom(mPrefix + name, path);
+	}
+};
+
+// the files kept in memory, e.g. to be sent back by a service.
+// the bytes are stored as given, so the text files keep the '\n' line ends of the writers
+class MemorySink : public OutputSink
+{
+protected:
+	mutable std::mutex mMutex;
+	std::map<std::string, std::vector<uint8_t>> mFiles;
+public:
+	virtual bool exists(const std::string& name) const override
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mFiles.find(name) != mFiles.end();
+	}
+	using OutputSink::write;
+	virtual void write(const std::string& name, const SPAN* parts, size_t count, bool) override
+	{
+		std::vector<uint8_t> data;
+		size_t size = 0;
+		for(size_t i = 0; i < count; i ++) size += parts[i].size;
+		data.resize(size);
+		size_t offset = 0;
+		for(size_t i = 0; i < count; i ++)
+		{
+			if(parts[i].size) memcpy(data.data() + offset, parts[i].data, parts[i].size);
+			offset += parts[i].size;
+		}
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFiles[name].swap(data);
+	}
+	// to be read after the conversion, when no task writes any more
+	const std::map<std::string, std::vector<uint8_t>>& getFiles() const
+	{
+		return mFiles;
+	}
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFiles.clear();
+	}
+};
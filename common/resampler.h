@@ -0,0 +1,165 @@
+//
+//  resampler.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "cpufeatures.h"
+
+// windowed-sinc polyphase resampler for whole buffers
+// the filter bank holds NumPhases + 1 phases of NumTaps taps,
+// the coefficients of a fractional position are interpolated linearly between the two nearest phases.
+// the output position is tracked with integer arithmetic, so there is no drift on long buffers.
+class PolyphaseResampler
+{
+public:
+	enum
+	{
+		NumTaps = 32,
+		NumPhases = 256,
+	};
+	using DotKernel = float(*)(const float* a, const float* b);
+protected:
+	uint32_t mInRate, mOutRate;
+	std::vector<float> mTable;
+	static double besselI0(double x)
+	{
+		double sum = 1, term = 1;
+		for(int k = 1; k < 32; k ++)
+		{
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+public:
+	PolyphaseResampler(uint32_t inrate, uint32_t outrate) : mInRate(inrate), mOutRate(outrate)
+	{
+		// cutoff relative to the input nyquist, lowered a bit to leave room for the transition band
+		const double pi = 3.14159265358979323846;
+		const double beta = 8.0;
+		double cutoff = 0.95 * ((outrate < inrate) ? (double)outrate / (double)inrate : 1.0);
+		const int half = NumTaps / 2;
+		mTable.resize((NumPhases + 1) * NumTaps);
+		for(int ip = 0; ip <= NumPhases; ip ++)
+		{
+			// tap k is applied to the input sample at (integer position - half + 1 + k)
+			double frac = (double)ip / NumPhases;
+			float* coefs = mTable.data() + ip * NumTaps;
+			double sum = 0;
+			for(int k = 0; k < NumTaps; k ++)
+			{
+				double d = (double)(k - half + 1) - frac;
+				double x = cutoff * d;
+				double sinc = (x == 0) ? 1.0 : std::sin(pi * x) / (pi * x);
+				double w = d / half;
+				double win = (std::abs(w) < 1) ? besselI0(beta * std::sqrt(1 - w * w)) / besselI0(beta) : 0;
+				double c = cutoff * sinc * win;
+				coefs[k] = (float)c;
+				sum += c;
+			}
+			// unity gain at DC for every phase
+			for(int k = 0; k < NumTaps; k ++) coefs[k] = (float)(coefs[k] / sum);
+		}
+	}
+	uint32_t getInputRate() const
+	{
+		return mInRate;
+	}
+	uint32_t getOutputRate() const
+	{
+		return mOutRate;
+	}
+	size_t getOutputLength(size_t inlength) const
+	{
+		return getOutputLength(inlength, mInRate, mOutRate);
+	}
+	// maps a sample position of the input onto the output, rounded to the nearest sample
+	uint32_t mapPosition(uint32_t pos) const
+	{
+		return mapPosition(pos, mInRate, mOutRate);
+	}
+	// the same without the filter bank
+	static size_t getOutputLength(size_t inlength, uint32_t inrate, uint32_t outrate)
+	{
+		return (size_t)(((uint64_t)inlength * outrate + inrate - 1) / inrate);
+	}
+	static uint32_t mapPosition(uint32_t pos, uint32_t inrate, uint32_t outrate)
+	{
+		return (uint32_t)(((uint64_t)pos * outrate + inrate / 2) / inrate);
+	}
+	// dst must hold getOutputLength(srclength) samples, the signal is zero outside of src
+	void process(const float* src, size_t srclength, float* dst) const
+	{
+		static const DotKernel dot = getDotKernel(CpuFeatures::getLevel());
+		const int half = NumTaps / 2;
+		std::vector<float> padded(srclength + NumTaps, 0.0f);
+		std::copy(src, src + srclength, padded.begin() + half - 1);
+		size_t outlength = getOutputLength(srclength);
+		for(size_t io = 0; io < outlength; io ++)
+		{
+			uint64_t num = (uint64_t)io * mInRate;
+			size_t ipos = (size_t)(num / mOutRate);
+			uint64_t rem = num % mOutRate;
+			// the phase and the interpolation weight between the phase and the next one
+			uint64_t phnum = rem * NumPhases;
+			size_t ph = (size_t)(phnum / mOutRate);
+			float a = (float)(phnum % mOutRate) / (float)mOutRate;
+			const float* x = padded.data() + ipos;
+			const float* c0 = mTable.data() + ph * NumTaps;
+			float y0 = dot(c0, x);
+			float y1 = dot(c0 + NumTaps, x);
+			dst[io] = y0 + (y1 - y0) * a;
+		}
+	}
+	static float dotScalar(const float* a, const float* b)
+	{
+		float sum = 0;
+		for(int k = 0; k < NumTaps; k ++) sum += a[k] * b[k];
+		return sum;
+	}
+#if TXW_X86
+	TXW_TARGET_SSE2 static float dotSSE2(const float* a, const float* b)
+	{
+		__m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+		for(int k = 0; k < NumTaps; k += 8)
+		{
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + k + 0), _mm_loadu_ps(b + k + 0)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4)));
+		}
+		__m128 s = _mm_add_ps(s0, s1);
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+	TXW_TARGET_AVX2 static float dotAVX2(const float* a, const float* b)
+	{
+		__m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+		for(int k = 0; k < NumTaps; k += 16)
+		{
+			s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + k + 0), _mm256_loadu_ps(b + k + 0)));
+			s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + k + 8), _mm256_loadu_ps(b + k + 8)));
+		}
+		__m256 s8 = _mm256_add_ps(s0, s1);
+		__m128 s = _mm_add_ps(_mm256_castps256_ps128(s8), _mm256_extractf128_ps(s8, 1));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+#endif
+	static DotKernel getDotKernel(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return dotAVX2;
+		if(level == CpuFeatures::LevelSSE2) return dotSSE2;
+#endif
+		return dotScalar;
+	}
+};
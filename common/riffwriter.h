@@ -7,10 +7,15 @@
 
 #pragma once
 
-#include <filesystem>
-#include <fstream>
+#include <stdint.h>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
 #include <vector>
 
+// the chunks of a RIFF file collected in memory, e.g. the headers of a file whose data is written after them by an OutputSink.
+// chunks descended with a known size get their final header immediately, and are checked on ascend.
+// chunks descended without size are patched on ascend.
 class RiffWriter
 {
 public:
@@ -19,21 +24,27 @@ public:
 		uint32_t ckoffset;
 		uint32_t ckid;
 		uint32_t cksize;
+		bool fixed;
 	};
-	std::fstream mStr;
 	std::vector<Chunk> mStack;
-	RiffWriter(const std::filesystem::path& path) : mStr(path, std::ios::out | std::ios::binary | std::ios::trunc)
+	std::vector<char> mBuffer;
+	RiffWriter()
 	{
-		mStr.exceptions(std::ios::badbit | std::ios::eofbit | std::ios::failbit);
 		descend("RIFF");
 	}
-	~RiffWriter()
+	// riffsize: the size of the RIFF chunk data, the form type included
+	RiffWriter(uint32_t riffsize)
 	{
-		while(!mStack.empty()) ascend();
+		descend("RIFF", riffsize);
 	}
-	operator bool() const
+	// the whole size of a chunk in the file, i.e. header + data + pad byte
+	static uint32_t chunkSize(uint32_t cksize)
 	{
-		return mStr.good();
+		return 8 + cksize + (cksize & 0x01);
+	}
+	uint32_t tell() const
+	{
+		return (uint32_t)mBuffer.size();
 	}
 	void descend(const char* ckid)
 	{
@@ -41,34 +52,62 @@ public:
 	}
 	void descend(uint32_t ckid)
 	{
-		uint32_t ckoffset = (uint32_t)mStr.tellp();
-		Chunk ck = { ckoffset, ckid, 8 };
+		Chunk ck = { tell(), ckid, 8, false };
 		mStack.push_back(ck);
-		mStr.write((const char*)&ck.ckid, 4);
-		mStr.write((const char*)&ck.cksize, 4);
+		write(&ck.ckid, 4);
+		write(&ck.cksize, 4);
+	}
+	void descend(const char* ckid, uint32_t cksize)
+	{
+		return descend(*(uint32_t*)ckid, cksize);
+	}
+	void descend(uint32_t ckid, uint32_t cksize)
+	{
+		Chunk ck = { tell(), ckid, cksize, true };
+		mStack.push_back(ck);
+		write(&ck.ckid, 4);
+		write(&ck.cksize, 4);
 	}
 	void ascend()
 	{
 		if(mStack.empty()) return;
-		Chunk& ck = mStack.back();
-		uint32_t endpos = (uint32_t)mStr.tellp();
-		ck.cksize = endpos - ck.ckoffset - 8;
-		mStr.seekp(ck.ckoffset + 4);
-		mStr.write((const char*)&ck.cksize, 4);
-		mStr.seekp(endpos);
-		if(endpos & 0x01) mStr.put(0);
+		Chunk ck = mStack.back();
 		mStack.pop_back();
+		uint32_t endpos = tell();
+		if(ck.fixed)
+		{
+			if(endpos - ck.ckoffset - 8 != ck.cksize) throw std::runtime_error("chunk size mismatch");
+		}
+		else
+		{
+			ck.cksize = endpos - ck.ckoffset - 8;
+			memcpy(mBuffer.data() + ck.ckoffset + 4, &ck.cksize, 4);
+		}
+		if(endpos & 0x01) { char z = 0; write(&z, 1); }
 	}
 	void write(const void* p, size_t c)
 	{
-		mStr.write((const char*)p, c);
+		mBuffer.insert(mBuffer.end(), (const char*)p, (const char*)p + c);
+	}
+	// the bytes so far with the chunks still open as they are, i.e. the sizes known or not yet patched,
+	// for the data of the last chunk to follow them elsewhere. the writer is left empty
+	std::vector<char> detach()
+	{
+		mStack.clear();
+		std::vector<char> buffer;
+		buffer.swap(mBuffer);
+		return buffer;
 	}
 	class ScopedDescend
 	{
 	public:
 		RiffWriter& writer;
-		ScopedDescend(RiffWriter& w, uint32_t ckid) : writer(w) { writer.descend(ckid); }
-		ScopedDescend(RiffWriter& w, const char* ckid) : writer(w) { writer.descend(ckid); }
-		~ScopedDescend() { writer.ascend(); }
+		int uncaught;
+		ScopedDescend(RiffWriter& w, uint32_t ckid) : writer(w), uncaught(std::uncaught_exceptions()) { writer.descend(ckid); }
+		ScopedDescend(RiffWriter& w, const char* ckid) : writer(w), uncaught(std::uncaught_exceptions()) { writer.descend(ckid); }
+		ScopedDescend(RiffWriter& w, uint32_t ckid, uint32_t cksize) : writer(w), uncaught(std::uncaught_exceptions()) { writer.descend(ckid, cksize); }
+		ScopedDescend(RiffWriter& w, const char* ckid, uint32_t cksize) : writer(w), uncaught(std::uncaught_exceptions()) { writer.descend(ckid, cksize); }
+		// ascend may throw, but not while unwinding
+		~ScopedDescend() noexcept(false) { if(std::uncaught_exceptions() == uncaught) writer.ascend(); }
 	};
 };
@@ -0,0 +1,108 @@
+//
+//  samplestore.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include "contenthash.h"
+
+// content addressed store of converted samples, shared by all the banks of a run and kept across runs
+// the first request of a key produces the file in the store, the concurrent requests of the same key wait for it.
+// every request then gets the stored file, to be linked or copied to its own output, cf. OutputSink::writeFrom.
+class SampleStore
+{
+protected:
+	std::filesystem::path mDir;
+	std::string mExtension;
+	std::mutex mMutex;
+	std::map<ContentHash, std::shared_future<void>> mEntries;
+	std::atomic<size_t> mNumProduced, mNumShared;
+public:
+	SampleStore(const std::filesystem::path& dir, const std::string& extension) : mDir(dir), mExtension(extension), mNumProduced(0), mNumShared(0)
+	{
+		std::filesystem::create_directories(dir);
+	}
+	SampleStore(const SampleStore&) = delete;
+	SampleStore& operator=(const SampleStore&) = delete;
+	const std::filesystem::path& getDirectory() const
+	{
+		return mDir;
+	}
+	// the number of files written to the store, and the number of requests served by an already stored file
+	size_t getProducedCount() const
+	{
+		return mNumProduced;
+	}
+	size_t getSharedCount() const
+	{
+		return mNumShared;
+	}
+	std::filesystem::path getPath(const ContentHash& key) const
+	{
+		return mDir / (key.toString() + mExtension);
+	}
+	// returns the stored file of the key.
+	// produce writes the file of the key to the given path, it is called at most once per key and may throw
+	std::filesystem::path acquire(const ContentHash& key, const std::function<void(const std::filesystem::path&)>& produce)
+	{
+		std::filesystem::path storepath = getPath(key);
+		std::promise<void> promise;
+		std::shared_future<void> ready;
+		bool producer = false;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto it = mEntries.find(key);
+			if(it == mEntries.end())
+			{
+				ready = promise.get_future().share();
+				mEntries[key] = ready;
+				producer = true;
+			}
+			else
+			{
+				ready = it->second;
+			}
+		}
+		if(producer)
+		{
+			try
+			{
+				if(std::filesystem::exists(storepath))
+				{
+					mNumShared ++;
+				}
+				else
+				{
+					// written aside and renamed, so that an interrupted run leaves no broken file in the store
+					std::filesystem::path tmppath = storepath;
+					tmppath += ".tmp";
+					produce(tmppath);
+					std::filesystem::rename(tmppath, storepath);
+					mNumProduced ++;
+				}
+				promise.set_value();
+			}
+			catch(...)
+			{
+				promise.set_exception(std::current_exception());
+				throw;
+			}
+		}
+		else
+		{
+			ready.get();
+			mNumShared ++;
+		}
+		return storepath;
+	}
+};
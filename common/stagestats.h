@@ -0,0 +1,187 @@
+//
+//  stagestats.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "strutil.h"
+
+// the time, the bytes, the samples and the files of each stage of a conversion.
+// updated by the concurrent tasks with relaxed atomics, the time is the sum over the threads.
+class StageStats
+{
+public:
+	enum Stage
+	{
+		Open, // mapping or gathering the input files
+		Parse, // the bank file headers and the cross reference
+		Decode, // 12-bit unpacking and resampling
+		WriteWave, // RIFF output
+		WriteText, // SFZ and catalog output
+		Store, // hashing and linking the waves of the sample store, without producing them
+		Manifest, // checking and recording the build manifest
+		NumStages,
+	};
+	static const char* getStageName(Stage stage)
+	{
+		static const char* names[] = { "open", "parse", "decode", "write_wave", "write_text", "store", "manifest" };
+		return names[stage];
+	}
+	// the time since the scope was entered is added to the stage, nothing is done without the stats
+	class Scope
+	{
+	protected:
+		StageStats* mStats;
+		Stage mStage;
+		uint64_t mStart;
+	public:
+		Scope(StageStats* stats, Stage stage) : mStats(stats), mStage(stage), mStart(stats ? now() : 0)
+		{
+		}
+		~Scope()
+		{
+			if(mStats) mStats->addTime(mStage, now() - mStart);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+protected:
+	struct COUNTERS
+	{
+		std::atomic<uint64_t> nanoseconds, bytes, samples, files;
+	} mCounters[NumStages];
+public:
+	StageStats()
+	{
+		for(COUNTERS& c : mCounters) c.nanoseconds = c.bytes = c.samples = c.files = 0;
+	}
+	StageStats(const StageStats&) = delete;
+	StageStats& operator=(const StageStats&) = delete;
+	// in nanoseconds
+	static uint64_t now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	void addTime(Stage stage, uint64_t nanoseconds)
+	{
+		mCounters[stage].nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+	}
+	void add(Stage stage, uint64_t bytes, uint64_t samples, uint64_t files)
+	{
+		COUNTERS& c = mCounters[stage];
+		c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+		c.samples.fetch_add(samples, std::memory_order_relaxed);
+		c.files.fetch_add(files, std::memory_order_relaxed);
+	}
+	void merge(const StageStats& o)
+	{
+		for(int is = 0; is < NumStages; is ++)
+		{
+			const COUNTERS& c = o.mCounters[is];
+			addTime((Stage)is, c.nanoseconds.load(std::memory_order_relaxed));
+			add((Stage)is, c.bytes.load(std::memory_order_relaxed), c.samples.load(std::memory_order_relaxed), c.files.load(std::memory_order_relaxed));
+		}
+	}
+	double getSeconds(Stage stage) const
+	{
+		return (double)mCounters[stage].nanoseconds.load(std::memory_order_relaxed) * 1e-9;
+	}
+	uint64_t getBytes(Stage stage) const
+	{
+		return mCounters[stage].bytes.load(std::memory_order_relaxed);
+	}
+	uint64_t getSamples(Stage stage) const
+	{
+		return mCounters[stage].samples.load(std::memory_order_relaxed);
+	}
+	uint64_t getFiles(Stage stage) const
+	{
+		return mCounters[stage].files.load(std::memory_order_relaxed);
+	}
+	// ================================================================================
+	// reports of named units, e.g. the banks, and their total
+	typedef std::vector<std::pair<std::string, std::shared_ptr<StageStats>>> UNITS;
+	static void printReport(std::ostream& str, const UNITS& units, const StageStats& total, double wallseconds)
+	{
+		str << "stage       time(ms)    files        bytes      samples" << std::endl;
+		str << "---------- --------- -------- ------------ ------------" << std::endl;
+		for(int is = 0; is < NumStages; is ++)
+		{
+			Stage stage = (Stage)is;
+			str << StrUtil::format(128, "%-10s %9.1f %8llu %12llu %12llu",
+				getStageName(stage),
+				total.getSeconds(stage) * 1e3,
+				(unsigned long long)total.getFiles(stage),
+				(unsigned long long)total.getBytes(stage),
+				(unsigned long long)total.getSamples(stage)) << std::endl;
+		}
+		str << StrUtil::format(128, "wall time  %9.1f", wallseconds * 1e3) << std::endl;
+		if(units.size() < 2) return;
+		// the time of each stage per unit, in ms
+		str << std::endl;
+		std::string header;
+		for(int is = 0; is < NumStages; is ++) header += StrUtil::format(32, " %10s", getStageName((Stage)is));
+		str << "time(ms) of each unit" << std::endl;
+		str << header << "  unit" << std::endl;
+		for(const auto& unit : units)
+		{
+			std::string line;
+			for(int is = 0; is < NumStages; is ++) line += StrUtil::format(32, " %10.1f", unit.second->getSeconds((Stage)is) * 1e3);
+			str << line << "  " << unit.first << std::endl;
+		}
+	}
+	static std::string quoteJSON(const std::string& s)
+	{
+		std::string q = "\"";
+		for(char c : s)
+		{
+			if((c == '"') || (c == '\\')) { q += '\\'; q += c; }
+			else if((unsigned char)c < 0x20) q += StrUtil::format(8, "\\u%04x", (unsigned int)(unsigned char)c);
+			else q += c;
+		}
+		return q + "\"";
+	}
+	void writeJSON(std::ostream& str) const
+	{
+		str << "{";
+		for(int is = 0; is < NumStages; is ++)
+		{
+			Stage stage = (Stage)is;
+			str << StrUtil::format(256, "%s\"%s\": { \"seconds\": %.6f, \"files\": %llu, \"bytes\": %llu, \"samples\": %llu }",
+				(is == 0) ? " " : ", ",
+				getStageName(stage),
+				getSeconds(stage),
+				(unsigned long long)getFiles(stage),
+				(unsigned long long)getBytes(stage),
+				(unsigned long long)getSamples(stage));
+		}
+		str << " }";
+	}
+	static void writeReportJSON(std::ostream& str, const std::string& tool, const UNITS& units, const StageStats& total, double wallseconds)
+	{
+		str << "{" << std::endl;
+		str << "  \"tool\": " << quoteJSON(tool) << "," << std::endl;
+		str << StrUtil::format(64, "  \"wall_seconds\": %.6f,", wallseconds) << std::endl;
+		str << "  \"total\": "; total.writeJSON(str); str << "," << std::endl;
+		str << "  \"units\": [" << std::endl;
+		for(size_t cu = units.size(), iu = 0; iu < cu; iu ++)
+		{
+			str << "    { \"name\": " << quoteJSON(units[iu].first) << ", \"stages\": ";
+			units[iu].second->writeJSON(str);
+			str << " }" << ((iu + 1 < cu) ? "," : "") << std::endl;
+		}
+		str << "  ]" << std::endl;
+		str << "}" << std::endl;
+	}
+};
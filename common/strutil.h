@@ -8,6 +8,13 @@
 #pragma once
 
 #include <cstdarg>
+#include <cstdio>
+#include <cctype>
+#if defined _MSC_VER
+#include <malloc.h>
+#else
+#include <alloca.h>
+#endif
 #include <string>
 #include <algorithm>
 
@@ -30,12 +37,14 @@ struct StrUtil
 	{
 		return "\"" + s + "\"";
 	}
+	*/
 	static bool isEqualNoCase(const std::string& a, const std::string& b)
 	{
 		std::string at = a; std::transform(at.begin(), at.end(), at.begin(), tolower);
 		std::string bt = b; std::transform(bt.begin(), bt.end(), bt.begin(), tolower);
 		return at == bt;
 	}
+	/*
 	static std::string toHex(const void* p, int c)
 	{
 		std::stringstream str;
@@ -0,0 +1,168 @@
+//
+//  tarsink.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "outputsink.h"
+
+// the files streamed one after another into an uncompressed POSIX tar archive, i.e. one large file instead of many,
+// the names may contain '/'. each file goes out whole under the lock, so the concurrent writes never interleave.
+// the bytes are stored as given, so the text files keep the '\n' line ends of the writers.
+// the names longer than the ustar header are recorded in pax headers.
+class TarSink : public OutputSink
+{
+protected:
+	enum { BlockSize = 512 };
+	mutable std::mutex mMutex;
+	std::unique_ptr<std::ofstream> mFile;
+	std::vector<char> mFileBuffer;
+	std::ostream* mStream;
+	std::string mName;
+	std::set<std::string> mNames;
+	uint64_t mMTime;
+	uint64_t mBytes;
+	bool mFinished;
+	// octal digits in c - 1 bytes and a NUL
+	static void putOctal(char* p, size_t c, uint64_t v)
+	{
+		p[c - 1] = 0;
+		for(size_t i = c - 1; 0 < i; i --, v >>= 3) p[i - 1] = (char)('0' + (v & 7));
+	}
+	static void putString(char* p, size_t c, const std::string& s)
+	{
+		memcpy(p, s.data(), std::min(c, s.size()));
+	}
+	void putBytes(const void* p, size_t c)
+	{
+		if(!mStream->write((const char*)p, (std::streamsize)c)) throw std::runtime_error("failed to write: \"" + mName + "\"");
+		mBytes += c;
+	}
+	void putPadding(uint64_t size)
+	{
+		static const char zeros[BlockSize] = {};
+		size_t c = (size_t)((BlockSize - size % BlockSize) % BlockSize);
+		if(c) putBytes(zeros, c);
+	}
+	void putHeader(const std::string& name, const std::string& prefix, uint64_t size, char type)
+	{
+		char hdr[BlockSize] = {};
+		putString(hdr, 100, name);
+		putOctal(hdr + 100, 8, 0644); // mode
+		putOctal(hdr + 108, 8, 0); // uid
+		putOctal(hdr + 116, 8, 0); // gid
+		putOctal(hdr + 124, 12, size);
+		putOctal(hdr + 136, 12, mMTime);
+		memset(hdr + 148, ' ', 8); // the checksum counts itself as spaces
+		hdr[156] = type;
+		memcpy(hdr + 257, "ustar", 6);
+		memcpy(hdr + 263, "00", 2);
+		putString(hdr + 345, 155, prefix);
+		unsigned int sum = 0;
+		for(unsigned char c : hdr) sum += c;
+		putOctal(hdr + 148, 7, sum);
+		putBytes(hdr, sizeof(hdr));
+	}
+	// the name in the header, split into the prefix and the name at a '/' if it is too long, or a pax header before it
+	void putEntryHeader(const std::string& name, uint64_t size)
+	{
+		if(name.size() <= 100)
+		{
+			putHeader(name, "", size, '0');
+			return;
+		}
+		for(size_t pos = name.find('/'); pos != std::string::npos; pos = name.find('/', pos + 1))
+		{
+			if((pos <= 155) && (name.size() - pos - 1 <= 100) && (pos + 1 < name.size()))
+			{
+				putHeader(name.substr(pos + 1), name.substr(0, pos), size, '0');
+				return;
+			}
+		}
+		// "<length> path=<name>\n", the length counts its own digits
+		std::string body = " path=" + name + "\n";
+		size_t length = body.size() + 1;
+		while(std::to_string(length).size() + body.size() != length) length ++;
+		std::string record = std::to_string(length) + body;
+		putHeader("PaxHeaders/" + name.substr(name.size() - 80), "", record.size(), 'x');
+		putBytes(record.data(), record.size());
+		putPadding(record.size());
+		putHeader(name.substr(name.size() - 100), "", size, '0');
+	}
+public:
+	// the archive is created at the path, throws on failure
+	TarSink(const std::filesystem::path& path) : mFileBuffer(1 << 20), mStream(nullptr), mName(path.filename().string()), mMTime((uint64_t)std::time(nullptr)), mBytes(0), mFinished(false)
+	{
+		mFile.reset(new std::ofstream());
+		mFile->rdbuf()->pubsetbuf(mFileBuffer.data(), (std::streamsize)mFileBuffer.size());
+		mFile->open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!*mFile) throw std::runtime_error("failed to create: \"" + mName + "\"");
+		mStream = mFile.get();
+	}
+	// the archive is written to the stream, e.g. a pipe to an uploader, which must outlive the sink
+	TarSink(std::ostream& str, const std::string& name = "tar") : mStream(&str), mName(name), mMTime((uint64_t)std::time(nullptr)), mBytes(0), mFinished(false)
+	{
+	}
+	// finishes the archive if not yet, the errors are lost then
+	virtual ~TarSink()
+	{
+		try { finish(); }
+		catch(std::exception&) {}
+	}
+	TarSink(const TarSink&) = delete;
+	TarSink& operator=(const TarSink&) = delete;
+	// the bytes written so far
+	uint64_t getBytes() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mBytes;
+	}
+	virtual bool exists(const std::string& name) const override
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mNames.find(name) != mNames.end();
+	}
+	using OutputSink::write;
+	virtual void write(const std::string& name, const SPAN* parts, size_t count, bool) override
+	{
+		uint64_t size = 0;
+		for(size_t i = 0; i < count; i ++) size += parts[i].size;
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(mFinished) throw std::runtime_error("archive finished: \"" + mName + "\"");
+		putEntryHeader(name, size);
+		for(size_t i = 0; i < count; i ++) if(parts[i].size) putBytes(parts[i].data, parts[i].size);
+		putPadding(size);
+		mNames.insert(name);
+	}
+	// writes the end of the archive and flushes it, nothing can be written after. throws on failure
+	void finish()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(mFinished) return;
+		mFinished = true;
+		static const char zeros[BlockSize * 2] = {};
+		putBytes(zeros, sizeof(zeros));
+		if(!mStream->flush()) throw std::runtime_error("failed to write: \"" + mName + "\"");
+		if(mFile)
+		{
+			mFile->close();
+			if(!*mFile) throw std::runtime_error("failed to write: \"" + mName + "\"");
+		}
+	}
+};
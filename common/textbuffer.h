@@ -0,0 +1,151 @@
+//
+//  textbuffer.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// append-only text, formatted in place without temporary strings, and handed to a sink in one go.
+// the capacity is kept over clear(), so that a buffer reused for many files stops allocating.
+// width: right aligned in the width if positive, left aligned if negative, as printf's "%5u" and "%-5s".
+class TextBuffer
+{
+protected:
+	std::string mText;
+	void appendPadded(const char* p, size_t c, int width, char fill)
+	{
+		size_t w = (size_t)((width < 0) ? -width : width);
+		size_t padding = (c < w) ? (w - c) : 0;
+		if(0 < width) mText.append(padding, fill);
+		mText.append(p, c);
+		if(width < 0) mText.append(padding, ' ');
+	}
+public:
+	TextBuffer()
+	{
+		mText.reserve(4096);
+	}
+	// a buffer for each thread, to be cleared by the user
+	static TextBuffer& getThreadLocal()
+	{
+		thread_local TextBuffer buffer;
+		return buffer;
+	}
+	void clear()
+	{
+		mText.clear();
+	}
+	const std::string& str() const
+	{
+		return mText;
+	}
+	size_t size() const
+	{
+		return mText.size();
+	}
+	TextBuffer& operator<<(char c)
+	{
+		mText.push_back(c);
+		return *this;
+	}
+	TextBuffer& operator<<(const char* s)
+	{
+		mText.append(s);
+		return *this;
+	}
+	TextBuffer& operator<<(const std::string& s)
+	{
+		mText.append(s);
+		return *this;
+	}
+	TextBuffer& operator<<(int v)
+	{
+		return appendInt(v);
+	}
+	TextBuffer& operator<<(unsigned int v)
+	{
+		return appendInt(v);
+	}
+	TextBuffer& appendString(const std::string& s, int width = 0)
+	{
+		appendPadded(s.data(), s.size(), width, ' ');
+		return *this;
+	}
+	TextBuffer& appendChars(const char* p, size_t c, int width = 0)
+	{
+		appendPadded(p, c, width, ' ');
+		return *this;
+	}
+	// "\"s\"" in the width
+	TextBuffer& appendQuoted(const std::string& s, int width = 0)
+	{
+		char q[64];
+		if(s.size() + 2 <= sizeof(q))
+		{
+			q[0] = '"';
+			memcpy(q + 1, s.data(), s.size());
+			q[s.size() + 1] = '"';
+			appendPadded(q, s.size() + 2, width, ' ');
+		}
+		else
+		{
+			std::string l = "\"" + s + "\"";
+			appendPadded(l.data(), l.size(), width, ' ');
+		}
+		return *this;
+	}
+	// fill: '0' for "%02u"
+	TextBuffer& appendInt(int64_t v, int width = 0, char fill = ' ')
+	{
+		char s[24];
+		std::to_chars_result r = std::to_chars(s, s + sizeof(s), v);
+		if((v < 0) && (fill == '0'))
+		{
+			// the sign precedes the zeros, "-5" in "%03d" is "-05"
+			mText.push_back('-');
+			appendPadded(s + 1, r.ptr - s - 1, (0 < width) ? width - 1 : width, fill);
+		}
+		else appendPadded(s, r.ptr - s, width, fill);
+		return *this;
+	}
+	// as printf's "%g"
+	TextBuffer& appendDouble(double v)
+	{
+		char s[32];
+#if defined __cpp_lib_to_chars
+		std::to_chars_result r = std::to_chars(s, s + sizeof(s), v, std::chars_format::general, 6);
+		mText.append(s, r.ptr - s);
+#else
+		// no floating point std::to_chars in this library
+		int c = std::snprintf(s, sizeof(s), "%g", v);
+		mText.append(s, (size_t)c);
+#endif
+		return *this;
+	}
+	// as printf's "%.*f", or "%+.*f" with sign, for the values of some digits before the point
+	TextBuffer& appendFixed(double v, int precision, int width = 0, bool sign = false)
+	{
+		char s[64];
+		size_t c = 0;
+		if(sign && !std::signbit(v)) s[c ++] = '+';
+#if defined __cpp_lib_to_chars
+		std::to_chars_result r = std::to_chars(s + c, s + sizeof(s), v, std::chars_format::fixed, precision);
+		c = (r.ec == std::errc()) ? (size_t)(r.ptr - s) : c;
+#else
+		int n = std::snprintf(s + c, sizeof(s) - c, "%.*f", precision, v);
+		c = std::min(sizeof(s) - 1, c + (size_t)std::max(n, 0));
+#endif
+		appendPadded(s, c, width, ' ');
+		return *this;
+	}
+};
@@ -0,0 +1,203 @@
+//
+//  threadpool.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// fixed size pool of worker threads with work stealing
+// each worker owns a deque, the jobs it submits are pushed to the back and run by itself in LIFO order,
+// an idle worker steals from the front of the others. the jobs submitted from outside of the pool go to a shared queue.
+// a job can wait for a group of jobs it has submitted, it runs the jobs of the workers' deques meanwhile.
+class ThreadPool
+{
+public:
+	// a set of jobs to be waited for independently of the other jobs on the pool
+	class Group
+	{
+	protected:
+		std::atomic<size_t> mPending;
+		friend class ThreadPool;
+	public:
+		Group() : mPending(0)
+		{
+		}
+		Group(const Group&) = delete;
+		Group& operator=(const Group&) = delete;
+	};
+protected:
+	struct JOB
+	{
+		std::function<void()> fn;
+		Group* group;
+	};
+	struct QUEUE
+	{
+		std::mutex mutex;
+		std::deque<JOB> jobs;
+	};
+	size_t mNumThreads;
+	std::vector<std::thread> mThreads;
+	// one for each worker, and the shared one at the end
+	std::vector<std::unique_ptr<QUEUE>> mQueues;
+	std::mutex mMutex;
+	std::condition_variable mWork, mDone;
+	std::atomic<size_t> mQueued, mStealable, mPending;
+	size_t mHelpers;
+	bool mQuit;
+	static std::pair<const ThreadPool*, size_t>& currentWorker()
+	{
+		thread_local std::pair<const ThreadPool*, size_t> worker(nullptr, 0);
+		return worker;
+	}
+	// the index of the calling worker, or the index of the shared queue if the caller is not a worker of this pool
+	size_t getWorkerIndex() const
+	{
+		const std::pair<const ThreadPool*, size_t>& worker = currentWorker();
+		return (worker.first == this) ? worker.second : mNumThreads;
+	}
+	bool popBack(size_t iq, JOB& job)
+	{
+		QUEUE& q = *mQueues[iq];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if(q.jobs.empty()) return false;
+		job = std::move(q.jobs.back());
+		q.jobs.pop_back();
+		return true;
+	}
+	bool popFront(size_t iq, JOB& job)
+	{
+		QUEUE& q = *mQueues[iq];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if(q.jobs.empty()) return false;
+		job = std::move(q.jobs.front());
+		q.jobs.pop_front();
+		return true;
+	}
+	// its own deque first, then the other workers', then the shared queue unless helping
+	bool pop(size_t self, JOB& job, bool helping)
+	{
+		size_t n = mNumThreads;
+		bool got = popBack(self, job);
+		for(size_t i = 1; !got && (i < n); i ++) got = popFront((self + i) % n, job);
+		if(got) mStealable --;
+		else if(!helping) got = popFront(n, job);
+		if(got) mQueued --;
+		return got;
+	}
+	void run(JOB& job)
+	{
+		job.fn();
+		// the group may be gone as soon as its count reaches zero
+		bool groupdone = job.group && (-- job.group->mPending == 0);
+		bool alldone = -- mPending == 0;
+		if(groupdone || alldone)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mDone.notify_all();
+		}
+	}
+	void runWorker(size_t self)
+	{
+		currentWorker() = { this, self };
+		for(;;)
+		{
+			JOB job;
+			if(pop(self, job, false)) { run(job); continue; }
+			std::unique_lock<std::mutex> lock(mMutex);
+			if(mQuit && (mQueued == 0)) return;
+			mWork.wait(lock, [this]() { return mQuit || (0 < mQueued); });
+		}
+	}
+	void enqueue(Group* group, std::function<void()>&& fn)
+	{
+		if(group) group->mPending ++;
+		mPending ++;
+		mQueued ++;
+		size_t self = getWorkerIndex();
+		bool local = self < mNumThreads;
+		if(local) mStealable ++;
+		{
+			QUEUE& q = *mQueues[self];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.jobs.push_back({ std::move(fn), group });
+		}
+		std::lock_guard<std::mutex> lock(mMutex);
+		mWork.notify_one();
+		if(local && (0 < mHelpers)) mDone.notify_all();
+	}
+	void waitFor(Group* group)
+	{
+		auto done = [this, group]() { return group ? (group->mPending == 0) : (mPending == 0); };
+		size_t self = getWorkerIndex();
+		bool worker = self < mNumThreads;
+		while(!done())
+		{
+			// a waiting worker runs only the jobs submitted by the workers, not the shared ones,
+			// so that the nesting of waits is bounded by the nesting of the jobs
+			JOB job;
+			if(worker && pop(self, job, true)) { run(job); continue; }
+			std::unique_lock<std::mutex> lock(mMutex);
+			if(worker) mHelpers ++;
+			mDone.wait(lock, [&]() { return done() || (worker && (0 < mStealable)); });
+			if(worker) mHelpers --;
+		}
+	}
+public:
+	ThreadPool(unsigned int numthreads) : mNumThreads((numthreads != 0) ? numthreads : getDefaultThreadCount()), mQueued(0), mStealable(0), mPending(0), mHelpers(0), mQuit(false)
+	{
+		for(size_t i = 0; i <= mNumThreads; i ++) mQueues.emplace_back(new QUEUE());
+		for(size_t i = 0; i < mNumThreads; i ++) mThreads.emplace_back([this, i]() { runWorker(i); });
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWork.notify_all();
+		for(auto& t : mThreads) t.join();
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	static unsigned int getDefaultThreadCount()
+	{
+		unsigned int n = std::thread::hardware_concurrency();
+		return (0 < n) ? n : 1;
+	}
+	size_t getThreadCount() const
+	{
+		return mNumThreads;
+	}
+	// jobs must not throw
+	void submit(std::function<void()> job)
+	{
+		enqueue(nullptr, std::move(job));
+	}
+	void submit(Group& group, std::function<void()> job)
+	{
+		enqueue(&group, std::move(job));
+	}
+	// blocks until every submitted job has finished, must not be called from a job
+	void wait()
+	{
+		waitFor(nullptr);
+	}
+	// blocks until every job of the group has finished, can be called from a job
+	void wait(Group& group)
+	{
+		waitFor(&group);
+	}
+};
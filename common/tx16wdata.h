@@ -0,0 +1,915 @@
+//
+//  tx16wdata.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+#include "tx16wtypes.h"
+#include "CurveMapping.h"
+#include "threadpool.h"
+#include "filesource.h"
+#include "samplestore.h"
+#include "stagestats.h"
+#include "textbuffer.h"
+#include "outputsink.h"
+#include "filebatch.h"
+#include "tx16wview.h"
+
+// ================================================================================
+// TXWParam
+
+// the TX16W parameters of 0~99 in the units of SFZ, looked up in the tables built at the first use.
+// the tables cover the whole byte, so that the out of range values of a broken bank extrapolate as the curves.
+// the curves are those of the original conversion.
+struct TXWParam
+{
+	typedef FABB::CurveMapTable<double, 256> TABLE;
+	// AEG rates, (99,0) => (0.001,10) seconds
+	static double getRateSeconds(uint8_t v)
+	{
+		static const TABLE table([](double x) { return 1.0 / FABB::CurveMapExponentialD(0, 99, 0.1, 1000).Map(x); });
+		return table.Map(v);
+	}
+	// AEG levels, (0,99) => (0,100) percent
+	static double getLevelPercent(uint8_t v)
+	{
+		static const TABLE table([](double x) { return FABB::CurveMapLinearD(0, 99, 0, 100).Map(x); });
+		return table.Map(v);
+	}
+};
+
+// ================================================================================
+// TX16WData
+
+// a bank of setup, performances, voices, timbres and waves, and its conversion to the SFZ files
+class TX16WData
+{
+public:
+	static TextBuffer& appendChannel(TextBuffer& tb, unsigned int ch, int width = 0)
+	{
+		if(17 <= ch) return tb.appendChars("----", 4, width);
+		if(ch == 16) return tb.appendChars("omni", 4, width);
+		return tb.appendInt(ch, width);
+	}
+	static const char* formatOutput(unsigned int o)
+	{
+		static const char* so[] = {" off", "I   ", "  II", "I+II"};
+		return (o < std::size(so)) ? so[o] : "----";
+	}
+	// a level in dBFS, "-inf" for 0, and "0.0" rather than "-0.0" just below the full scale, e.g. the largest 12-bit sample
+	static TextBuffer& appendLevel(TextBuffer& tb, double v, int width = 0)
+	{
+		if(v <= 0) return tb.appendChars("-inf", 4, width);
+		double db = TXWSampleStats::toDB(v);
+		if((-0.05 < db) && (db < 0)) db = 0.0;
+		return tb.appendFixed(db, 1, width);
+	}
+	// YAMAHA style pitch notation
+	static TextBuffer& appendNoteName(TextBuffer& tb, unsigned int k, int width = 0)
+	{
+		static const char* st[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+		char s[16];
+		size_t c = strlen(st[k % 12]);
+		memcpy(s, st[k % 12], c);
+		c = std::to_chars(s + c, s + sizeof(s), (int)(k / 12) - 2).ptr - s;
+		return tb.appendChars(s, c, width);
+	}
+	union { TXWSETUPV1 v1; TXWSETUPV2 v2; } mSetup;
+	std::array<TXWWAVENAME, TXW_COUNTOF_WAVES> mWaveNames; // 16*64=1024 bytes
+	std::array<TXWPERF, TXW_COUNTOF_PERFS> mPerformances; // 146*32=4672 bytes
+	std::array<TXWVOICE, TXW_COUNTOF_VOICES> mVoices; // 146*32=4672 bytes
+	std::vector<TXWTIMBRE> mTimbres; // 56*64=3584 or 56*128=7168 bytes
+	std::array<TXWVOICEV2EXTRA, TXW_COUNTOF_VOICES> mVoicesV2X; // 64x32=2048 bytes
+	std::vector<TXWTIMBREV2EXTRA> mTimbresV2X; // 8*128=1024 bytes
+	bool mIsSetupV2, mIsPerfV2, mIsVoiceV2;
+	struct WAVE
+	{
+		std::string name;
+		std::string filename;
+		TXWWAVE txw;
+		uint32_t pcmlength;
+		bool isv2;
+		TXWSampleStats stats; // gathered by the conversion, if analyzed
+		bool analyzed;
+	};
+	std::array<WAVE, TXW_COUNTOF_WAVES> mWaves;
+	// a timbre slot of a voice, which plays an existing wave within a valid key range
+	struct VOICETIMBRE
+	{
+		size_t slot;
+		size_t timbre;
+		size_t wave;
+		uint8_t lokey, hikey, orgkey;
+	};
+	// a sounding voice of a performance, i.e. the first entry of its group
+	struct PERFVOICE
+	{
+		size_t entry;
+		size_t voice;
+	};
+	// cross reference between the performances, voices, timbres and waves, built once after loading.
+	// the index lists are in ascending order without duplicates.
+	struct XREF
+	{
+		std::array<std::vector<PERFVOICE>, TXW_COUNTOF_PERFS> perfvoices;
+		std::array<std::vector<VOICETIMBRE>, TXW_COUNTOF_VOICES> voicetimbres;
+		std::array<std::vector<size_t>, TXW_COUNTOF_VOICES> voiceperfs;
+		std::vector<std::vector<size_t>> timbrevoices;
+		std::array<std::vector<size_t>, TXW_COUNTOF_WAVES> wavetimbres, wavevoices, waveperfs;
+		std::array<std::vector<uint8_t>, TXW_COUNTOF_WAVES> waverootkeys;
+	} mXRef;
+	StageStats* mStats; // optional, not cleared
+	mutable FileBatch mBatch; // the files opened ahead, taken by the loading and the decoding
+	std::vector<std::string> mSelection; // the performances to convert by number or name, all if empty, not cleared
+	std::array<bool, TXW_COUNTOF_PERFS> mPerfSelected; // resolved from mSelection by selectPerformances()
+	std::array<bool, TXW_COUNTOF_WAVES> mWaveSelected; // the waves played by the selected performances
+	TXWWaveOptions mWaveOptions; // of the conversion, for the names and the loops of the sample files
+	bool mWriteJSON; // the statistics of the samples also into "<basename>.json", not cleared
+	TX16WData() : mSetup(), mIsSetupV2(false), mIsPerfV2(false), mIsVoiceV2(false), mStats(nullptr), mWriteJSON(false)
+	{
+		mPerfSelected.fill(true);
+		mWaveSelected.fill(true);
+	}
+	// the files are opened in parallel with a pool, the bank files and then the waves, in two round trips
+	void openAhead(const FileSource& source, const std::vector<std::string>& names, size_t headerbytes, ThreadPool* pool)
+	{
+		StageStats::Scope scope(mStats, StageStats::Open);
+		uint64_t bytes = mBatch.open(source, names, headerbytes, pool);
+		if(mStats) mStats->add(StageStats::Open, bytes, 0, names.size());
+	}
+	FileSource::File openFile(const FileSource& source, const std::string& name) const
+	{
+		StageStats::Scope scope(mStats, StageStats::Open);
+		FileSource::File file;
+		if(mBatch.take(name, &file)) return file;
+		file = source.open(name);
+		if(mStats) mStats->add(StageStats::Open, file.size(), 0, 1);
+		return file;
+	}
+	void clear()
+	{
+		mSetup = {};
+		mWaveNames = {};
+		mPerformances = {};
+		mVoices = {};
+		mTimbres.clear();
+		mVoicesV2X = {};
+		mTimbresV2X.clear();
+		mIsSetupV2 = false;
+		mIsPerfV2 = false;
+		mIsVoiceV2 = false;
+		mWaves = {};
+		mXRef = {};
+		mBatch.clear();
+		mPerfSelected.fill(true);
+		mWaveSelected.fill(true);
+	}
+	// reads the bank files from a directory or a diskette image, opened in parallel with a pool
+	void load(const FileSource& source, const std::string& basename, bool verbose, ThreadPool* pool = nullptr)
+	{
+		clear();
+		openAhead(source, getBankFileNames(basename), SIZE_MAX, pool);
+		loadSetup(source, basename, verbose);
+		openAhead(source, getWaveFileNames(), sizeof(TXWFILEHDR) + sizeof(TXWWAVE), pool);
+		loadWaves(source, verbose);
+		loadPerformances(source, basename, verbose);
+		loadVoices(source, basename, verbose);
+		buildIndex();
+		mBatch.clear();
+	}
+	// setup and wave names
+	void loadSetup(const FileSource& source, const std::string& basename, bool verbose, std::ostream& log = std::cout)
+	{
+		// setup
+		{
+			std::string name = basename + ".S01";
+			if(verbose) log << "reading " << std::filesystem::path(name) << std::endl;
+			FileSource::File file = openFile(source, name);
+			StageStats::Scope scope(mStats, StageStats::Parse);
+			if(mStats) mStats->add(StageStats::Parse, file.size(), 0, 1);
+			TXWSetupView view(file.data(), file.size());
+			mIsSetupV2 = view.isV2();
+			if(mIsSetupV2) mSetup.v2 = view.getSetupV2();
+			else		   mSetup.v1 = view.getSetupV1();
+			std::copy(view.getWaveNames().begin(), view.getWaveNames().end(), mWaveNames.begin());
+		}
+		for(size_t cw = mWaveNames.size(), iw = 0; iw < cw; iw ++)
+		{
+			WAVE& wave = mWaves[iw];
+			wave.name = TXWUtil::extractWaveName(mWaveNames[iw]);
+			if(!wave.name.empty()) wave.filename = wave.name + StrUtil::format(128, ".W%02u", iw + 1);
+		}
+	}
+	// wave headers, the files opened ahead are left for the decoding
+	void loadWaves(const FileSource& source, bool verbose, std::ostream& log = std::cout)
+	{
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++)
+		{
+			WAVE& wave = mWaves[iw];
+			if(wave.name.empty() || !mWaveSelected[iw]) continue;
+			if(verbose) log << "reading " << std::filesystem::path(wave.filename) << std::endl;
+			FileSource::File opened;
+			const FileSource::File* txw = mBatch.find(wave.filename);
+			if(!txw)
+			{
+				opened = openFile(source, wave.filename);
+				txw = &opened;
+			}
+			StageStats::Scope scope(mStats, StageStats::Parse);
+			TXWWAVEIMAGE img = {};
+			if(img.parse(txw->data(), txw->size()))
+			{
+				wave.isv2 = img.isv2;
+				wave.txw = *img.wave;
+				wave.pcmlength = img.pcmlength;
+			}
+		}
+	}
+	void loadPerformances(const FileSource& source, const std::string& basename, bool verbose, std::ostream& log = std::cout)
+	{
+		// performances
+		{
+			std::string name = basename + ".U01";
+			if(verbose) log << "reading " << std::filesystem::path(name) << std::endl;
+			FileSource::File file = openFile(source, name);
+			StageStats::Scope scope(mStats, StageStats::Parse);
+			if(mStats) mStats->add(StageStats::Parse, file.size(), 0, 1);
+			TXWPerformanceView view(file.data(), file.size());
+			mIsPerfV2 = view.isV2();
+			std::copy(view.getPerformances().begin(), view.getPerformances().end(), mPerformances.begin());
+		}
+	}
+	void loadVoices(const FileSource& source, const std::string& basename, bool verbose, std::ostream& log = std::cout)
+	{
+		// voices and timbres
+		{
+			std::string name = basename + ".V01";
+			if(verbose) log << "reading " << std::filesystem::path(name) << std::endl;
+			FileSource::File file = openFile(source, name);
+			StageStats::Scope scope(mStats, StageStats::Parse);
+			if(mStats) mStats->add(StageStats::Parse, file.size(), 0, 1);
+			TXWVoiceView view(file.data(), file.size());
+			mIsVoiceV2 = view.isV2();
+			std::copy(view.getVoices().begin(), view.getVoices().end(), mVoices.begin());
+			mTimbres.assign(view.getTimbres().begin(), view.getTimbres().end());
+			mTimbresV2X.resize(mTimbres.size());
+			// V2 extra area
+			if(mIsVoiceV2)
+			{
+				std::copy(view.getVoicesV2X().begin(), view.getVoicesV2X().end(), mVoicesV2X.begin());
+				std::copy(view.getTimbresV2X().begin(), view.getTimbresV2X().end(), mTimbresV2X.begin());
+			}
+		}
+	}
+	void buildIndex()
+	{
+		StageStats::Scope scope(mStats, StageStats::Parse);
+		XREF& xref = mXRef;
+		xref = {};
+		auto append = [](std::vector<size_t>& v, size_t i) { if(v.empty() || (v.back() != i)) v.push_back(i); };
+		xref.timbrevoices.resize(mTimbres.size());
+		for(size_t ct = mTimbres.size(), it = 0; it < ct; it ++)
+		{
+			size_t waveindex = mTimbres[it].WaveNumber;
+			if((waveindex < mWaves.size()) && !mWaves[waveindex].name.empty()) xref.wavetimbres[waveindex].push_back(it);
+		}
+		for(size_t cv = mVoices.size(), iv = 0; iv < cv; iv ++)
+		{
+			for(size_t it = 0; it < TXW_COUNTOF_TIMBRES_PERVOICE; it ++)
+			{
+				const TXWVOICE::TIMBRE& vtmbr = mVoices[iv].timbres[it];
+				size_t timbreindex = vtmbr.Number;
+				if(mTimbres.size() <= timbreindex) continue;
+				const TXWTIMBRE& timbre = mTimbres[timbreindex];
+				size_t waveindex = timbre.WaveNumber;
+				if((mWaves.size() <= waveindex) || mWaves[waveindex].name.empty()) continue;
+				uint8_t lokey = vtmbr.LoKey.get(), hikey = vtmbr.HiKey.get();
+				if((127 < lokey) || (127 < hikey) || (hikey < lokey)) continue;
+				// the original key belongs to the voice timbre slot on V2, to the timbre on V1
+				uint8_t orgkey = mIsVoiceV2 ? mVoicesV2X[iv].timbres[it].getOriginalPitchKey() : timbre.OriginalPitch.get();
+				xref.voicetimbres[iv].push_back({ it, timbreindex, waveindex, lokey, hikey, orgkey });
+				append(xref.timbrevoices[timbreindex], iv);
+				append(xref.wavevoices[waveindex], iv);
+				xref.waverootkeys[waveindex].push_back(orgkey);
+			}
+		}
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++)
+		{
+			const TXWPERF& perf = mPerformances[ip];
+			uint8_t group = (uint8_t)-1;
+			for(size_t iv = 0; iv < TXW_COUNTOF_VOICES_PERPERF; iv ++)
+			{
+				if(perf.group[iv] == group) continue;
+				group = perf.group[iv];
+				size_t voiceindex = perf.voice[iv];
+				if(mVoices.size() <= voiceindex) continue;
+				// midi channel off, output off or zero volume
+				if((16 < perf.midich[iv]) || (perf.output[iv] == 0) || (perf.volume[iv] == 0)) continue;
+				if(xref.voicetimbres[voiceindex].empty()) continue;
+				xref.perfvoices[ip].push_back({ iv, voiceindex });
+				append(xref.voiceperfs[voiceindex], ip);
+				for(const VOICETIMBRE& vt : xref.voicetimbres[voiceindex]) append(xref.waveperfs[vt.wave], ip);
+			}
+		}
+		for(std::vector<uint8_t>& keys : xref.waverootkeys)
+		{
+			std::sort(keys.begin(), keys.end());
+			keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		}
+	}
+	// the performances of mSelection, each a number as in the sfz file names or a name regardless of case,
+	// and the waves they play through their voices and timbres. after buildIndex(), throws on an unknown entry
+	void selectPerformances()
+	{
+		mPerfSelected.fill(mSelection.empty());
+		mWaveSelected.fill(mSelection.empty());
+		if(mSelection.empty()) return;
+		for(const std::string& entry : mSelection)
+		{
+			std::string sel = StrUtil::trim(entry, " ");
+			bool isnumber = !sel.empty() && (sel.size() <= 3) && std::all_of(sel.begin(), sel.end(), [](char c) { return ('0' <= c) && (c <= '9'); });
+			bool found = false;
+			for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++)
+			{
+				if(isnumber ? (std::stoul(sel) == ip) : StrUtil::isEqualNoCase(StrUtil::trim(TXWUtil::extractName(mPerformances[ip]), " "), sel))
+				{
+					mPerfSelected[ip] = true;
+					found = true;
+				}
+			}
+			if(!found) throw std::runtime_error("no such performance: \"" + entry + "\"");
+		}
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++)
+		{
+			if(!mPerfSelected[ip]) continue;
+			for(const PERFVOICE& pv : mXRef.perfvoices[ip]) for(const VOICETIMBRE& vt : mXRef.voicetimbres[pv.voice]) mWaveSelected[vt.wave] = true;
+		}
+	}
+	void writeCatalog(OutputSink& sink, const std::string& basename, bool overwrite, bool verbose, std::ostream& log = std::cout) const
+	{
+		std::string name = basename + ".txt";
+		if(verbose) log << "writing text " << std::filesystem::path(name) << std::endl;
+		if(!overwrite && sink.exists(name)) throw std::runtime_error("path exists");
+		StageStats::Scope scope(mStats, StageStats::WriteText);
+		TextBuffer& cat = TextBuffer::getThreadLocal();
+		cat.clear();
+		cat << "txw2sfz\n";
+		cat << "bank: \"";
+		for(char c : basename) { if((c == '"') || (c == '\\')) cat << '\\'; cat << c; }
+		cat << "\"\n";
+		cat << "\n";
+		cat << "SETUP(V" << (mIsVoiceV2 ? 2 : 1) << ")\n";
+		cat << "tune=";
+		cat.appendInt(mSetup.v1.MasterTune.get(), 2, '0') << ", volume=[";
+		cat.appendInt(mSetup.v1.MasterVolI, 2, '0') << ",";
+		cat.appendInt(mSetup.v1.MasterVolII, 2, '0') << "]\n";
+		cat << "\n";
+		cat << "WAVENAMES\n";
+		cat << "#    name       file           fs    length atclen rptlen v2 \n";
+		cat << "---: ---------- -------------- ----- ------ ------ ------ ---\n";
+		for(size_t cw = mWaveNames.size(), iw = 0; iw < cw; iw ++)
+		{
+			const WAVE& wave = mWaves[iw]; if(wave.name.empty()) continue;
+			cat << "W";
+			cat.appendInt(iw, 2, '0') << ": ";
+			cat.appendQuoted(wave.name, -10) << " ";
+			cat.appendQuoted(wave.filename, -14) << " ";
+			cat.appendInt(wave.txw.getSampleRate(), 5) << " ";
+			cat.appendInt(wave.pcmlength, 6) << " ";
+			cat.appendInt(wave.txw.getAttackLength(), 6) << " ";
+			cat.appendInt(wave.txw.getRepeatLength(), 6) << " ";
+			cat.appendString(wave.isv2 ? "yes" : "no", 3) << "\n";
+		}
+		cat << "\n";
+		if(std::any_of(mWaves.begin(), mWaves.end(), [](const WAVE& wave) { return wave.analyzed; }))
+		{
+			// the levels in dBFS and the dc offset relative to the full scale, of the original samples
+			cat << "WAVESTATS\n";
+			cat << "#     peak    rms dc offset clipped  start    end\n";
+			cat << "---: ----- ------ --------- ------- ------ ------\n";
+			for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++)
+			{
+				const WAVE& wave = mWaves[iw]; if(!wave.analyzed) continue;
+				const TXWSampleStats& st = wave.stats;
+				cat << "W";
+				cat.appendInt(iw, 2, '0') << ": ";
+				appendLevel(cat, st.getPeak(), 5) << " ";
+				appendLevel(cat, st.getRMS(), 6) << " ";
+				cat.appendFixed(st.getDCOffset(), 6, 9, true) << " ";
+				cat.appendInt(st.clipped, 7) << " ";
+				if(st.isSilent()) cat << "     -      -\n";
+				else
+				{
+					cat.appendInt(st.start, 6) << " ";
+					cat.appendInt(st.end, 6) << "\n";
+				}
+			}
+			cat << "\n";
+		}
+		cat << "PERFORMANCES(V" << (mIsPerfV2 ? 2 : 1) << ")\n";
+		cat << "\t#  Voice Chn  Out  Volume Detune Shift\n";
+		cat << "\t-- ----- ---- ---- ------ ------ -----\n";
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++)
+		{
+			const TXWPERF& perf = mPerformances[ip];
+			cat << "P";
+			cat.appendInt(ip, 2, '0') << ": \"" << TXWUtil::extractName(perf) << "\"\n";
+			unsigned int group = (unsigned int)-1;
+			for(size_t iv = 0; iv < TXW_COUNTOF_VOICES_PERPERF; iv ++)
+			{
+				if(perf.group[iv] == group) continue;
+				group = perf.group[iv];
+				cat << "\t";
+				cat.appendInt(iv, 2) << " ";
+				cat.appendInt(perf.voice[iv], 5) << " ";
+				appendChannel(cat, perf.midich[iv], 4) << " ";
+				cat << formatOutput(perf.output[iv]) << " ";
+				cat.appendInt(perf.volume[iv], 6) << " ";
+				cat.appendInt(perf.detune[iv], 6) << " ";
+				cat.appendInt(perf.shift[iv], 5) << "\n";
+			}
+		}
+		cat << "\n";
+		cat << "VOICES(V" << (mIsVoiceV2 ? 2 : 1) << ")\n";
+		cat << "\t#  timber lo-k hi-k fade orgk \n";
+		cat << "\t-- ------ ---- ---- ---- ----\n";
+		for(size_t cv = mVoices.size(), iv = 0; iv < cv; iv ++)
+		{
+			const TXWVOICE& voice = mVoices[iv];
+			cat << "V";
+			cat.appendInt(iv, 2, '0') << ": \"" << TXWUtil::extractName(voice) << "\"\n";
+			for(const VOICETIMBRE& vt : mXRef.voicetimbres[iv])
+			{
+				cat << "\t";
+				cat.appendInt(vt.slot, 2) << " ";
+				cat.appendInt(vt.timbre, 6) << " ";
+				appendNoteName(cat, vt.lokey, 4) << " ";
+				appendNoteName(cat, vt.hikey, 4) << " ";
+				cat.appendInt(voice.timbres[vt.slot].Fade, 4) << " ";
+				if(mIsVoiceV2) appendNoteName(cat, vt.orgkey, 4) << "\n";
+				else cat << "----\n";
+			}
+		}
+		cat << "\n";
+		cat << "TIMBRES(V" << (mIsVoiceV2 ? 2 : 1) << ")\n";
+		cat << "#     name         wav root tune AAR AD1R AD1L AD2R AD2L ARR PR1 PL1 PR2 PL2 PR3 PL3 PR4 PL4 fixp 1shot\n";
+		cat << "----: ------------ --- ---- ---- --- ---- ---- ---- ---- --- --- --- --- --- --- --- --- --- ---- -----\n";
+		for(size_t ct = mTimbres.size(), it = 0; it < ct; it ++)
+		{
+			const TXWTIMBRE& timbre = mTimbres[it];
+			const TXWTIMBREV2EXTRA& tv2ext = mTimbresV2X[it];
+			if(mWaveNames.size() <= timbre.WaveNumber) continue;
+			if(TXWUtil::extractWaveName(mWaveNames[timbre.WaveNumber]).empty()) continue;
+			cat << "T";
+			cat.appendInt(it, 3, '0') << ": ";
+			cat.appendQuoted(TXWUtil::extractName(timbre), -12) << " ";
+			cat.appendInt(timbre.WaveNumber, 3) << " ";
+			if(mIsVoiceV2) cat << "----";
+			else appendNoteName(cat, timbre.OriginalPitch.get(), 4);
+			cat << " ";
+			cat.appendInt(timbre.tune.get(), 4) << " ";
+			cat.appendInt(timbre.AEGAR, 3) << " ";
+			cat.appendInt(timbre.AEGD1R, 4) << " ";
+			cat.appendInt(timbre.AEGD1L, 4) << " ";
+			cat.appendInt(timbre.AEGD2R, 4) << " ";
+			cat.appendInt(timbre.AEGD2L, 4) << " ";
+			const uint8_t pegs[] = { timbre.AEGRR, timbre.PEGR1, timbre.PEGL1, timbre.PEGR2, timbre.PEGL2, timbre.PEGR3, timbre.PEGL3, timbre.PEGR4, timbre.PEGL4 };
+			for(uint8_t v : pegs) cat.appendInt(v, 3) << " ";
+			if(!mIsVoiceV2) cat << "----";
+			else if(tv2ext.fixpitch.get() == 0x7fff) cat << " off";
+			else cat.appendInt(tv2ext.fixpitch.get(), 4);
+			cat << " ";
+			if(!mIsVoiceV2) cat << " ----";
+			else cat.appendInt(tv2ext.getOneshotTrigger(), 5);
+			cat << "\n";
+		}
+		cat << "\n";
+		cat << "WAVEUSAGE\n";
+		cat << "#    timbres voices perfs root keys\n";
+		cat << "---: ------- ------ ----- ---------\n";
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++)
+		{
+			if(mWaves[iw].name.empty()) continue;
+			cat << "W";
+			cat.appendInt(iw, 2, '0') << ": ";
+			cat.appendInt(mXRef.wavetimbres[iw].size(), 7);
+			if(mXRef.wavevoices[iw].empty())
+			{
+				cat << " unused\n";
+				continue;
+			}
+			cat << " ";
+			cat.appendInt(mXRef.wavevoices[iw].size(), 6) << " ";
+			cat.appendInt(mXRef.waveperfs[iw].size(), 5) << " ";
+			for(size_t ck = mXRef.waverootkeys[iw].size(), ik = 0; ik < ck; ik ++) appendNoteName(cat << ((ik == 0) ? "" : " "), mXRef.waverootkeys[iw][ik]);
+			cat << "\n";
+		}
+		sink.write(name, cat.str().data(), cat.size(), true);
+		if(mStats) mStats->add(StageStats::WriteText, cat.size(), 0, 1);
+	}
+	// the statistics of the waves analyzed by the conversion, for the tools reading them instead of the samples.
+	// start and end are the trimming points, null if silent, and the levels are relative to the full scale
+	void writeJSON(OutputSink& sink, const std::string& basename, bool overwrite, bool verbose, std::ostream& log = std::cout) const
+	{
+		std::string name = basename + ".json";
+		if(verbose) log << "writing text " << std::filesystem::path(name) << std::endl;
+		if(!overwrite && sink.exists(name)) throw std::runtime_error("path exists");
+		StageStats::Scope scope(mStats, StageStats::WriteText);
+		TextBuffer& js = TextBuffer::getThreadLocal();
+		js.clear();
+		auto number = [&js](double v) -> TextBuffer& { return std::isfinite(v) ? js.appendDouble(v) : (js << "null"); };
+		js << "{\n";
+		js << "  \"bank\": " << StageStats::quoteJSON(basename) << ",\n";
+		js << "  \"silence_threshold_db\": ";
+		number(TXWSampleStats::toDB(TXWSampleStats::SilenceThreshold / 32768.0)) << ",\n";
+		js << "  \"waves\": [";
+		bool first = true;
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++)
+		{
+			const WAVE& wave = mWaves[iw]; if(!wave.analyzed) continue;
+			const TXWSampleStats& st = wave.stats;
+			js << (first ? "\n" : ",\n");
+			first = false;
+			js << "    { \"wave\": " << (unsigned int)iw << ", \"name\": " << StageStats::quoteJSON(wave.name) << ", \"file\": " << StageStats::quoteJSON(getSampleFileName(iw));
+			js << ", \"samplerate\": " << wave.txw.getSampleRate() << ", \"length\": " << st.length;
+			js << ", \"peak\": ";
+			number(st.getPeak()) << ", \"peak_db\": ";
+			number(TXWSampleStats::toDB(st.getPeak())) << ", \"rms\": ";
+			number(st.getRMS()) << ", \"rms_db\": ";
+			number(TXWSampleStats::toDB(st.getRMS())) << ", \"dc_offset\": ";
+			number(st.getDCOffset()) << ", \"clipped\": " << st.clipped;
+			if(st.isSilent()) js << ", \"start\": null, \"end\": null }";
+			else js << ", \"start\": " << st.start << ", \"end\": " << st.end << " }";
+		}
+		js << (first ? "]\n" : "\n  ]\n");
+		js << "}\n";
+		sink.write(name, js.str().data(), js.size(), true);
+		if(mStats) mStats->add(StageStats::WriteText, js.size(), 0, 1);
+	}
+	void writeSFZ(OutputSink& sink, bool overwrite, bool verbose) const
+	{
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++) writePerformance(sink, ip, overwrite, verbose);
+	}
+	void writePerformance(OutputSink& sink, size_t ip, bool overwrite, bool verbose, std::ostream& log = std::cout) const
+	{
+		// Perf => sfz
+		// Voice => <group>
+		// Timbre => <region>
+		{
+			const TXWPERF& perf = mPerformances[ip];
+			const std::vector<PERFVOICE>& perfvoices = mXRef.perfvoices[ip];
+			if(perfvoices.empty()) return;
+			StageStats::Scope scope(mStats, StageStats::WriteText);
+			TextBuffer& sfz = TextBuffer::getThreadLocal();
+			sfz.clear();
+			for(const PERFVOICE& pv : perfvoices)
+			{
+				size_t iv = pv.entry;
+				sfz << "<group>\n";
+				uint8_t vmidich = perf.midich[iv]; // 0~15,16:omni
+				uint8_t voutput = perf.output[iv]; // 1:I,2:II,3:I+II
+				uint8_t vvolume = perf.volume[iv]; // 1~99
+				int8_t vdetune = perf.detune[iv]; // -7~7
+				int8_t vshift = perf.shift[iv]; // -24~24
+				if(vmidich < 16) sfz << "lochan=" << vmidich + 1 << " hichan=" << vmidich + 1 << "\n";
+				else			 sfz << "lochan=1 hichan=16\n";
+				if     (voutput == 1) sfz << "pan=-100\n";
+				else if(voutput == 2) sfz << "pan=100\n";
+				else				  sfz << "pan=0\n";
+				sfz << "volume=";
+				sfz.appendDouble((double)vvolume - 99) << "\n";
+				for(const VOICETIMBRE& vt : mXRef.voicetimbres[pv.voice])
+				{
+					const TXWTIMBRE& timbre = mTimbres[vt.timbre];
+					const TXWTIMBREV2EXTRA& timbreext = mTimbresV2X[vt.timbre];
+					const WAVE& wave = mWaves[vt.wave];
+					sfz << "<region>";
+					uint8_t lokey = vt.lokey, hikey = vt.hikey, orgkey = vt.orgkey;
+					uint8_t fixedpitchshift = mIsVoiceV2 ? timbreext.fixpitch.get() : 0x7fff;
+					bool fixedpitchenabled = fixedpitchshift == 0x7fff;
+					int oneshotms = mIsVoiceV2 ? timbreext.getOneshotTrigger() : 0;
+					bool oneshotenabled = oneshotms != 0;
+					int tune = timbre.tune.get(); // -200~200
+					sfz << " sample=" << getSampleFileName(vt.wave);
+					sfz << " lokey=" << std::clamp(lokey + vshift, 0, 127) << " hikey=" << std::clamp(hikey + vshift, 0, 127);
+					sfz << " pitch_keycenter=" << std::clamp(orgkey + vshift, 0, 127);
+					sfz << " tune=" << (int)((vdetune * 50.0 / 7.0) + (tune * 100.0 / 200.0));
+					if(fixedpitchenabled) sfz << " transpose=" << (int)fixedpitchshift << " pitch_keytrack=0";
+					if(oneshotenabled) sfz << " loop_mode=one_shot";
+					else if((mWaveOptions.filetype == TXWFileTypeFlac) && wave.txw.isLooped())
+					{
+						// no sampler chunk in the FLAC itself for most players
+						uint32_t loopbegin, loopend;
+						TXWUtil::getOutputLoop(wave.txw, wave.pcmlength, mWaveOptions, &loopbegin, &loopend);
+						sfz << " loop_mode=loop_continuous loop_start=" << loopbegin << " loop_end=" << loopend;
+					}
+					// aeg
+					sfz << " ampeg_attack=";
+					sfz.appendDouble(TXWParam::getRateSeconds(timbre.AEGAR));
+					sfz << " ampeg_decay=";
+					sfz.appendDouble(TXWParam::getRateSeconds(timbre.AEGD1R) + TXWParam::getRateSeconds(timbre.AEGD2R));
+					sfz << " ampeg_sustain=";
+					sfz.appendDouble(TXWParam::getLevelPercent(timbre.AEGD2L));
+					sfz << " ampeg_release=";
+					sfz.appendDouble(TXWParam::getRateSeconds(timbre.AEGRR));
+					//
+					// TODO: more modulations
+					//
+					sfz << "\n";
+				}
+			}
+			std::string name = getPerformanceFileName(ip);
+			if(verbose) log << "writing sfz " << std::filesystem::path(name) << std::endl;
+			if(!overwrite && sink.exists(name)) throw std::runtime_error("path exists");
+			sink.write(name, sfz.str().data(), sfz.size(), true);
+			if(mStats) mStats->add(StageStats::WriteText, sfz.size(), 0, 1);
+		}
+	}
+	std::string getPerformanceFileName(size_t ip) const
+	{
+		std::string name = (ip < 10) ? "0" : "";
+		name += std::to_string(ip);
+		name += ' ';
+		name += StrUtil::replaceFileSystemUnsafedChars(TXWUtil::extractName(mPerformances[ip]));
+		name += ".sfz";
+		return name;
+	}
+	// "name.wav" or "name.flac"
+	std::string getSampleFileName(size_t iw) const
+	{
+		return mWaves[iw].name + TXWUtil::getFileExtension(mWaveOptions.filetype);
+	}
+	static std::vector<std::string> getBankFileNames(const std::string& basename)
+	{
+		return { basename + ".S01", basename + ".U01", basename + ".V01" };
+	}
+	// the wave files named by the setup, of the selected performances
+	std::vector<std::string> getWaveFileNames() const
+	{
+		std::vector<std::string> names;
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++) if(!mWaves[iw].name.empty() && mWaveSelected[iw]) names.push_back(mWaves[iw].filename);
+		return names;
+	}
+	// the bank files and the wave files read by a conversion
+	std::vector<std::string> getInputFileNames(const std::string& basename) const
+	{
+		std::vector<std::string> names = getBankFileNames(basename);
+		std::vector<std::string> wavenames = getWaveFileNames();
+		names.insert(names.end(), wavenames.begin(), wavenames.end());
+		return names;
+	}
+	// the files written by a conversion, no catalog for a selection
+	std::vector<std::filesystem::path> getOutputPaths(const std::filesystem::path& outputdir, const std::string& basename) const
+	{
+		std::vector<std::filesystem::path> paths;
+		if(mSelection.empty()) paths.push_back(outputdir / (basename + ".txt"));
+		if(mWriteJSON) paths.push_back(outputdir / (basename + ".json"));
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++) if(!mXRef.perfvoices[ip].empty() && mPerfSelected[ip]) paths.push_back(outputdir / getPerformanceFileName(ip));
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++) if(!mWaves[iw].name.empty() && mWaveSelected[iw]) paths.push_back(outputdir / getSampleFileName(iw));
+		return paths;
+	}
+	// the original key of the first voice (V2) or timbre (V1) playing the wave, 60 if none
+	uint8_t getOriginalKey(size_t iw) const
+	{
+		if(mIsVoiceV2)
+		{
+			if(mXRef.wavevoices[iw].empty()) return 60;
+			for(const VOICETIMBRE& vt : mXRef.voicetimbres[mXRef.wavevoices[iw].front()]) if(vt.wave == iw) return vt.orgkey;
+		}
+		else
+		{
+			if(!mXRef.wavetimbres[iw].empty()) return mTimbres[mXRef.wavetimbres[iw].front()].OriginalPitch.get();
+		}
+		return 60;
+	}
+	// loads the bank from the source and writes everything into the sink as concurrent tasks on the pool,
+	// both may be in memory, e.g. for a service converting the uploaded banks.
+	// the bank files and then the wave files are opened in parallel,
+	// the waves are decoded while the performances and voices are still being parsed,
+	// and are written as soon as their original keys are known.
+	// the messages are reported to log and errlog in the same order as a serial run.
+	// this can run as a job of the pool itself, it waits only for its own tasks.
+	// with a store, the waves are linked from it instead, each decoded only if the store does not have it yet.
+	// with a selection, the metadata is loaded first and only the selected performances and their waves are
+	// read and written, without the catalog.
+	// the waves are analyzed as they are unpacked, and the catalog with their statistics is written after them.
+	void convert(const FileSource& source, const std::string& basename, OutputSink& sink, bool overwrite, const TXWWaveOptions& waveoptions, ThreadPool& pool, SampleStore* store, bool verbose, std::ostream& log = std::cout, std::ostream& errlog = std::cerr)
+	{
+		struct TASK
+		{
+			std::stringstream log;
+			bool failed = false;
+			std::string err;
+		};
+		enum { MetadataLoading, MetadataReady, MetadataFailed };
+		clear();
+		mWaveOptions = waveoptions;
+		bool selective = !mSelection.empty();
+		openAhead(source, getBankFileNames(basename), SIZE_MAX, &pool);
+		loadSetup(source, basename, verbose, log);
+		if(selective)
+		{
+			loadPerformances(source, basename, verbose, log);
+			loadVoices(source, basename, verbose, log);
+			buildIndex();
+			selectPerformances();
+		}
+		openAhead(source, getWaveFileNames(), sizeof(TXWFILEHDR) + sizeof(TXWWAVE), &pool);
+		loadWaves(source, verbose, log);
+		ThreadPool::Group group;
+		std::array<TASK, TXW_COUNTOF_WAVES> wavetasks;
+		// the waves decoded before the metadata is ready are kept until then, so that no task blocks
+		std::array<TXWDECODEDWAVE, TXW_COUNTOF_WAVES> decodedwaves;
+		std::vector<size_t> deferredwaves;
+		std::mutex metadatamutex;
+		int metadatastate = MetadataLoading;
+		auto writewave = [&](size_t iw, const TXWDECODEDWAVE& dw)
+		{
+			TASK& task = wavetasks[iw];
+			const WAVE& wave = mWaves[iw];
+			try
+			{
+				std::string wavname = getSampleFileName(iw);
+				if(verbose) task.log << "converting wave \"" << wave.filename << "\" =>" << std::filesystem::path(wavname) << std::endl;
+				StageStats::Scope scope(mStats, StageStats::WriteWave);
+				TXWUtil::writeWave(dw, sink, wavname, getOriginalKey(iw), overwrite);
+				if(mStats) mStats->add(StageStats::WriteWave, dw.data.size(), 0, 1);
+			}
+			catch(std::exception& e)
+			{
+				task.failed = true;
+				task.err = e.what();
+			}
+		};
+		// the key of a stored wave includes the original key, so they wait for the metadata
+		auto linkwave = [&](size_t iw)
+		{
+			TASK& task = wavetasks[iw];
+			const WAVE& wave = mWaves[iw];
+			try
+			{
+				std::string wavname = getSampleFileName(iw);
+				if(verbose) task.log << "converting wave \"" << wave.filename << "\" =>" << std::filesystem::path(wavname) << std::endl;
+				if(!overwrite && sink.exists(wavname)) throw std::runtime_error("path exists");
+				FileSource::File file = openFile(source, wave.filename);
+				TXWWaveReader txw(file.data(), file.size());
+				uint8_t orgkey = getOriginalKey(iw);
+				// the store stage excludes the producing, which is counted as decoding and writing
+				uint64_t start = mStats ? StageStats::now() : 0, produced = 0;
+				std::filesystem::path storepath = store->acquire(TXWUtil::hashWave(txw, waveoptions, orgkey), [&](const std::filesystem::path& path)
+				{
+					uint64_t t0 = mStats ? StageStats::now() : 0;
+					TXWDECODEDWAVE dw;
+					{
+						StageStats::Scope scope(mStats, StageStats::Decode);
+						TXWUtil::decodeWave(txw, waveoptions, &dw, &mWaves[iw].stats);
+						mWaves[iw].analyzed = true;
+						if(mStats) mStats->add(StageStats::Decode, txw.getImage().pcmbytes, dw.length, 1);
+					}
+					{
+						StageStats::Scope scope(mStats, StageStats::WriteWave);
+						TXWUtil::writeWave(dw, path, orgkey, true);
+						if(mStats) mStats->add(StageStats::WriteWave, dw.data.size(), 0, 1);
+					}
+					if(mStats) produced = StageStats::now() - t0;
+				});
+				sink.writeFrom(wavname, storepath);
+				if(!mWaves[iw].analyzed)
+				{
+					// not decoded as the store had it, the image was just hashed and is still in the cache
+					StageStats::Scope scope(mStats, StageStats::Decode);
+					TXWAnalysis::analyze(txw.getImage().pcm, txw.getLength() / 2, &mWaves[iw].stats);
+					mWaves[iw].analyzed = true;
+				}
+				if(mStats)
+				{
+					mStats->addTime(StageStats::Store, StageStats::now() - start - produced);
+					mStats->add(StageStats::Store, 0, 0, 1);
+				}
+			}
+			catch(std::exception& e)
+			{
+				task.failed = true;
+				task.err = e.what();
+			}
+		};
+		for(size_t cw = mWaves.size(), iw = 0; iw < cw; iw ++)
+		{
+			if(store || mWaves[iw].name.empty() || !mWaveSelected[iw]) continue;
+			pool.submit(group, [&, iw]()
+			{
+				TASK& task = wavetasks[iw];
+				TXWDECODEDWAVE dw;
+				try
+				{
+					FileSource::File file = openFile(source, mWaves[iw].filename);
+					StageStats::Scope scope(mStats, StageStats::Decode);
+					TXWWaveReader txw(file.data(), file.size());
+					TXWUtil::decodeWave(txw, waveoptions, &dw, &mWaves[iw].stats);
+					mWaves[iw].analyzed = true;
+					if(mStats) mStats->add(StageStats::Decode, txw.getImage().pcmbytes, dw.length, 1);
+				}
+				catch(std::exception& e)
+				{
+					task.failed = true;
+					task.err = e.what();
+					return;
+				}
+				{
+					std::lock_guard<std::mutex> lock(metadatamutex);
+					if(metadatastate == MetadataFailed) return;
+					if(metadatastate == MetadataLoading)
+					{
+						decodedwaves[iw] = std::move(dw);
+						deferredwaves.push_back(iw);
+						return;
+					}
+				}
+				writewave(iw, dw);
+			});
+		}
+		try
+		{
+			if(!selective)
+			{
+				loadPerformances(source, basename, verbose, log);
+				loadVoices(source, basename, verbose, log);
+				buildIndex();
+			}
+		}
+		catch(...)
+		{
+			{
+				std::lock_guard<std::mutex> lock(metadatamutex);
+				metadatastate = MetadataFailed;
+			}
+			pool.wait(group);
+			mBatch.clear();
+			throw;
+		}
+		std::vector<size_t> readywaves;
+		{
+			std::lock_guard<std::mutex> lock(metadatamutex);
+			metadatastate = MetadataReady;
+			readywaves.swap(deferredwaves);
+		}
+		for(size_t iw : readywaves)
+		{
+			pool.submit(group, [&, iw]()
+			{
+				writewave(iw, decodedwaves[iw]);
+				decodedwaves[iw] = {};
+			});
+		}
+		for(size_t cw = mWaves.size(), iw = 0; store && (iw < cw); iw ++)
+		{
+			if(mWaves[iw].name.empty() || !mWaveSelected[iw]) continue;
+			pool.submit(group, [&, iw]() { linkwave(iw); });
+		}
+		std::array<TASK, TXW_COUNTOF_PERFS> perftasks;
+		for(size_t cp = mPerformances.size(), ip = 0; ip < cp; ip ++)
+		{
+			if(!mPerfSelected[ip]) continue;
+			pool.submit(group, [&, ip]()
+			{
+				TASK& task = perftasks[ip];
+				try { writePerformance(sink, ip, overwrite, verbose, task.log); }
+				catch(std::exception& e) { task.failed = true; task.err = e.what(); }
+			});
+		}
+		pool.wait(group);
+		mBatch.clear();
+		TASK catalogtask;
+		try
+		{
+			if(!selective) writeCatalog(sink, basename, overwrite, verbose, catalogtask.log);
+			if(mWriteJSON) writeJSON(sink, basename, overwrite, verbose, catalogtask.log);
+		}
+		catch(std::exception& e) { catalogtask.failed = true; catalogtask.err = e.what(); }
+		log << catalogtask.log.str();
+		if(catalogtask.failed) throw std::runtime_error(catalogtask.err);
+		for(const TASK& task : perftasks)
+		{
+			log << task.log.str();
+			if(task.failed) throw std::runtime_error(task.err);
+		}
+		for(const TASK& task : wavetasks)
+		{
+			log << task.log.str();
+			if(task.failed) errlog << "ERROR: " << task.err << std::endl;
+		}
+	}
+};
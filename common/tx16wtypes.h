@@ -9,9 +9,19 @@
 
 #include <stdint.h>
 #include <string>
+#include <cstring>
+#include <cmath>
+#include <memory>
 #include "strutil.h"
 #include "riffwriter.h"
+#include "outputsink.h"
 #include "wavfmt.h"
+#include "txwunpack.h"
+#include "txwanalysis.h"
+#include "mappedfile.h"
+#include "resampler.h"
+#include "contenthash.h"
+#include "flacencoder.h"
 
 // references:
 //   setup, performances, voices, timbres: voltex.c, MIDI bulk dump format specification
@@ -64,6 +74,14 @@ struct TXWFILEHDR
 	uint8_t reserved0[1]; // zeros
 	uint8_t version[4]; // V1:zeros, V2:"0200"
 	uint8_t reserved1[5]; // zeros
+	bool isValid() const
+	{
+		return memcmp(signature, "LM8953", 6) == 0;
+	}
+	bool isV2() const
+	{
+		return version[1] == '2';
+	}
 };
 
 // 231(0xe7) bytes
@@ -195,6 +213,10 @@ struct TXWWAVE
 	uint8_t atc_length[3]; // I'll get to this...
 	uint8_t rpt_length[3];
 	uint8_t reserved1[2]; // set these to null, to be on the safe side
+	bool isLooped() const
+	{
+		return (format & 0x80) ? false : true;
+	}
 	uint32_t getAttackLength() const
 	{
 		return (((uint32_t)atc_length[2] & 0x01) << 16) | ((uint32_t)atc_length[1] << 8) | (uint32_t)atc_length[0];
@@ -218,6 +240,175 @@ struct TXWWAVE
 
 #pragma pack(pop)
 
+enum TXWSampleFormat
+{
+	TXWSampleFormatInt16 = 0,
+	TXWSampleFormatInt24,
+	TXWSampleFormatFloat32,
+};
+
+enum TXWFileType
+{
+	TXWFileTypeWave = 0,
+	TXWFileTypeFlac, // 16-bit or 24-bit only
+};
+
+// output options for the wave conversion
+struct TXWWaveOptions
+{
+	TXWSampleFormat format = TXWSampleFormatInt16;
+	uint32_t samplerate = 0; // 0: keep the native rate
+	TXWFileType filetype = TXWFileTypeWave;
+};
+
+// a wave decoded into the output format, ready to be written
+struct TXWDECODEDWAVE
+{
+	uint32_t samplerate = 0;
+	uint32_t length = 0; // in samples
+	bool looped = false;
+	uint32_t loopbegin = 0, loopend = 0;
+	TXWSampleFormat format = TXWSampleFormatInt16;
+	TXWFileType filetype = TXWFileTypeWave;
+	std::vector<uint8_t> data;
+};
+
+// in-place view of a wave file image, points into the file data
+struct TXWWAVEIMAGE
+{
+	bool isv2;
+	const TXWWAVE* wave;
+	const uint8_t* pcm;
+	size_t pcmbytes;
+	uint32_t pcmlength; // in samples
+	bool parse(const uint8_t* p, size_t c)
+	{
+		if(c < sizeof(TXWFILEHDR) + sizeof(TXWWAVE)) return false;
+		const TXWFILEHDR& fh = *(const TXWFILEHDR*)p;
+		if(!fh.isValid()) return false;
+		isv2 = fh.isV2();
+		wave = (const TXWWAVE*)(p + sizeof(TXWFILEHDR));
+		pcm = p + sizeof(TXWFILEHDR) + sizeof(TXWWAVE);
+		pcmbytes = c - sizeof(TXWFILEHDR) - sizeof(TXWWAVE);
+		pcmlength = (uint32_t)(pcmbytes / 3 * 2);
+		return true;
+	}
+};
+
+// ================================================================================
+// wave reader
+
+// pull-based decoder for the wave files (.W??)
+// frames are decoded on demand into caller supplied buffers
+class TXWWaveReader
+{
+protected:
+	std::unique_ptr<MappedFile> mFile;
+	TXWWAVEIMAGE mImage;
+	uint32_t mPosition;
+	void setup(const uint8_t* p, size_t c)
+	{
+		mImage = {};
+		mPosition = 0;
+		if(!mImage.parse(p, c)) throw std::runtime_error("invalid signature");
+	}
+public:
+	// maps the file, throws on failure
+	TXWWaveReader(const std::filesystem::path& path) : mFile(new MappedFile(path))
+	{
+		setup(mFile->data(), mFile->size());
+	}
+	// reads from a caller owned file image, which must outlive the reader
+	TXWWaveReader(const uint8_t* p, size_t c)
+	{
+		setup(p, c);
+	}
+	bool isV2() const
+	{
+		return mImage.isv2;
+	}
+	const TXWWAVEIMAGE& getImage() const
+	{
+		return mImage;
+	}
+	const TXWWAVE& getWave() const
+	{
+		return *mImage.wave;
+	}
+	// 0 if unknown
+	uint32_t getSampleRate() const
+	{
+		return mImage.wave->getSampleRate();
+	}
+	uint32_t getLength() const
+	{
+		return mImage.pcmlength;
+	}
+	bool isLooped() const
+	{
+		return mImage.wave->isLooped();
+	}
+	uint32_t getLoopStart() const
+	{
+		return mImage.wave->getAttackLength();
+	}
+	// includes the last sample (TBV)
+	uint32_t getLoopEnd() const
+	{
+		return mImage.wave->getAttackLength() + mImage.wave->getRepeatLength() - 1;
+	}
+	uint32_t getPosition() const
+	{
+		return mPosition;
+	}
+	void setPosition(uint32_t pos)
+	{
+		mPosition = std::min(pos, mImage.pcmlength);
+	}
+	// decodes up to numframes frames from the current position, return the number of frames decoded
+	size_t read(int16_t* dst, size_t numframes)
+	{
+		return readFrames(dst, numframes, 1, TXWUnpack::unpackScalar, [](const uint8_t* src, int16_t* dst, size_t numgroups) { TXWUnpack::unpack(src, dst, numgroups); });
+	}
+	size_t read(float* dst, size_t numframes)
+	{
+		return readFrames(dst, numframes, 1, TXWUnpack::unpackFloat32Scalar, [](const uint8_t* src, float* dst, size_t numgroups) { TXWUnpack::unpack(src, dst, numgroups); });
+	}
+	// 3 bytes per frame
+	size_t readInt24(uint8_t* dst, size_t numframes)
+	{
+		return readFrames(dst, numframes, 3, TXWUnpack::unpackInt24Scalar, TXWUnpack::unpackInt24);
+	}
+protected:
+	// width: elements of T per frame
+	template<typename T, typename F> size_t readFrames(T* dst, size_t numframes, size_t width, void(*scalar)(const uint8_t*, T*, size_t), F kernel)
+	{
+		size_t n = std::min(numframes, (size_t)(mImage.pcmlength - mPosition));
+		size_t done = 0;
+		T pair[2 * 3];
+		if((mPosition & 1) && (done < n))
+		{
+			// odd position, take the second sample of the group
+			scalar(mImage.pcm + (mPosition / 2) * 3, pair, 1);
+			std::copy(pair + width, pair + width * 2, dst);
+			done ++;
+			mPosition ++;
+		}
+		size_t ng = (n - done) / 2;
+		kernel(mImage.pcm + (mPosition / 2) * 3, dst + done * width, ng);
+		done += ng * 2;
+		mPosition += (uint32_t)(ng * 2);
+		if(done < n)
+		{
+			scalar(mImage.pcm + (mPosition / 2) * 3, pair, 1);
+			std::copy(pair, pair + width, dst + done * width);
+			done ++;
+			mPosition ++;
+		}
+		return done;
+	}
+};
+
 // ================================================================================
 // utilities
 
@@ -225,11 +416,10 @@ struct TXWUtil
 {
 	static bool parseFileHeader(std::istream& s, bool* v2)
 	{
-		static const std::string sig("LM8953");
 		TXWFILEHDR fh;
 		s.read((char*)&fh, sizeof(fh));
-		if(sig != fh.signature) return false;
-		*v2 = (fh.version[1] == '2') ? true : false;
+		if(!fh.isValid()) return false;
+		*v2 = fh.isV2();
 		return true;
 	}
 	template<class T> static std::string extractName(const T& st)
@@ -249,70 +439,265 @@ struct TXWUtil
 		if(std::size(wn.sizeinfo) <= l) return ""; // sizeinfo == all zero
 		return StrUtil::trim(extractName(wn), " ");
 	}
-	static bool convertWave(const std::filesystem::path& txwpath, const std::filesystem::path& wavpath, uint8_t orgkey, bool overwrite, std::string* err)
+	static uint32_t getBytesPerSample(TXWSampleFormat format)
 	{
-		bool r = false;
-		try
+		if(format == TXWSampleFormatInt24) return 3;
+		if(format == TXWSampleFormatFloat32) return 4;
+		return 2;
+	}
+	// "16", "24" or "32" (float)
+	static bool parseSampleFormat(const std::string& s, TXWSampleFormat* format)
+	{
+		if(s == "16") { *format = TXWSampleFormatInt16; return true; }
+		if(s == "24") { *format = TXWSampleFormatInt24; return true; }
+		if(s == "32") { *format = TXWSampleFormatFloat32; return true; }
+		return false;
+	}
+	// ".wav" or ".flac"
+	static const char* getFileExtension(TXWFileType filetype)
+	{
+		return (filetype == TXWFileTypeFlac) ? ".flac" : ".wav";
+	}
+	// the loop of a wave as decodeWave() puts it into the output, from the header alone
+	static void getOutputLoop(const TXWWAVE& wave, uint32_t length, const TXWWaveOptions& options, uint32_t* loopbegin, uint32_t* loopend)
+	{
+		uint32_t samplerate = wave.getSampleRate();
+		*loopbegin = wave.getAttackLength();
+		*loopend = wave.getAttackLength() + wave.getRepeatLength() - 1;
+		if((options.samplerate != 0) && (samplerate != 0) && (options.samplerate != samplerate) && (0 < length))
 		{
-			// read
-			std::fstream txw(txwpath, std::ios::in | std::ios::binary);
-			if(!txw) throw std::runtime_error("failed to open: \"" + txwpath.filename().string() + "\"");
-			txw.exceptions(std::ios::badbit | std::ios::eofbit | std::ios::failbit);
-			bool iswavev2 = false; if(!parseFileHeader(txw, &iswavev2)) throw std::runtime_error("invalid signature");
-			TXWWAVE wave; txw.read((char*)&wave, sizeof(wave));
-			uint32_t pcmoffset = (uint32_t)txw.tellg();
-			txw.seekg(0, std::ios_base::end);
-			uint32_t pcmlength = ((uint32_t)txw.tellg() - pcmoffset) / 3 * 2;
-			txw.seekg(pcmoffset);
-			uint32_t samplerate = wave.getSampleRate();
-			if(samplerate == 0) throw std::runtime_error("invalid samplerate");
-			uint32_t lattack = wave.getAttackLength(), lrepeat = wave.getRepeatLength();
-			uint32_t loopbegin = lattack;
-			uint32_t loopend = lattack + lrepeat - 1; // includes the last sample (TBV)
-			bool looped = (wave.format & 0x80) ? false : true;
-			// write
-			if(!overwrite && std::filesystem::exists(wavpath)) throw std::runtime_error("path exists");
-			RiffWriter wav(wavpath);
-			if(!wav) throw std::runtime_error("failed to create: \"" + wavpath.filename().string() + "\"");
-			wav.write("WAVE", 4);
+			uint32_t outlength = (uint32_t)PolyphaseResampler::getOutputLength(length, samplerate, options.samplerate);
+			*loopbegin = std::min(PolyphaseResampler::mapPosition(*loopbegin, samplerate, options.samplerate), outlength - 1);
+			*loopend = std::min(PolyphaseResampler::mapPosition(*loopend + 1, samplerate, options.samplerate) - 1, outlength - 1);
+		}
+	}
+	// float samples into the output format, rounded and clipped for the integer formats
+	static void quantizeSamples(const float* src, uint8_t* dst, size_t n, TXWSampleFormat format)
+	{
+		if(format == TXWSampleFormatFloat32)
+		{
+			memcpy(dst, src, n * sizeof(float));
+		}
+		else if(format == TXWSampleFormatInt24)
+		{
+			for(size_t i = 0; i < n; i ++, dst += 3)
 			{
-				RiffWriter::ScopedDescend sd(wav, "fmt ");
-				WaveFormatEx wf = {};
-				wf.wFormatTag = WaveFormatPcm;
-				wf.nChannels = 1;
-				wf.nSamplesPerSec = samplerate;
-				wf.nAvgBytesPerSec = samplerate * 2;
-				wf.nBlockAlign = 2;
-				wf.wBitsPerSample = 16;
-				wav.write(&wf, sizeof(wf));
+				int32_t v = (int32_t)std::lrint(std::clamp(src[i] * 8388608.0f, -8388608.0f, 8388607.0f));
+				dst[0] = (uint8_t)v; dst[1] = (uint8_t)(v >> 8); dst[2] = (uint8_t)(v >> 16);
 			}
+		}
+		else
+		{
+			int16_t* dw = (int16_t*)dst;
+			for(size_t i = 0; i < n; i ++) dw[i] = (int16_t)std::lrint(std::clamp(src[i] * 32768.0f, -32768.0f, 32767.0f));
+		}
+	}
+	// the samples unpacked in chunks, each analyzed in 16-bit and then converted from the same bytes while they are in the cache.
+	// width: elements of T per sample
+	template<typename T, typename F> static void unpackAnalyzed(const TXWWAVEIMAGE& img, T* dst, size_t width, F convert, TXWSampleStats* stats)
+	{
+		int16_t chunk[TXWAnalysis::ChunkGroups * 2];
+		for(size_t cg = img.pcmlength / 2, ig = 0, n = 0; ig < cg; ig += n)
+		{
+			n = std::min((size_t)TXWAnalysis::ChunkGroups, cg - ig);
+			TXWAnalysis::unpack(img.pcm + ig * 3, chunk, n, stats);
+			convert(img.pcm + ig * 3, dst + ig * 2 * width, n);
+		}
+	}
+	// decodes the whole wave into the output format, throws on failure.
+	// stats: the statistics of the original samples if given, gathered in the same pass as the unpacking
+	static void decodeWave(TXWWaveReader& txw, const TXWWaveOptions& options, TXWDECODEDWAVE* dw, TXWSampleStats* stats = nullptr)
+	{
+		dw->samplerate = txw.getSampleRate();
+		if(dw->samplerate == 0) throw std::runtime_error("invalid samplerate");
+		dw->length = txw.getLength();
+		dw->looped = txw.isLooped();
+		getOutputLoop(txw.getWave(), dw->length, options, &dw->loopbegin, &dw->loopend);
+		dw->format = options.format;
+		dw->filetype = options.filetype;
+		if((options.filetype == TXWFileTypeFlac) && (options.format == TXWSampleFormatFloat32)) throw std::runtime_error("no float samples in FLAC");
+		uint32_t bytespersample = getBytesPerSample(options.format);
+		const TXWWAVEIMAGE& img = txw.getImage();
+		auto unpackfloat = [](const uint8_t* src, float* dst, size_t numgroups) { TXWUnpack::unpack(src, dst, numgroups); };
+		if(stats) *stats = TXWSampleStats();
+		txw.setPosition(0);
+		if((options.samplerate != 0) && (options.samplerate != dw->samplerate) && (0 < dw->length))
+		{
+			// resample in float, then quantize into the output format
+			PolyphaseResampler rs(dw->samplerate, options.samplerate);
+			std::vector<float> src(dw->length);
+			if(stats) unpackAnalyzed(img, src.data(), 1, unpackfloat, stats);
+			else txw.read(src.data(), dw->length);
+			std::vector<float> resampled(rs.getOutputLength(dw->length));
+			rs.process(src.data(), dw->length, resampled.data());
+			dw->length = (uint32_t)resampled.size();
+			dw->samplerate = options.samplerate;
+			dw->data.resize((size_t)dw->length * bytespersample);
+			quantizeSamples(resampled.data(), dw->data.data(), dw->length, options.format);
+		}
+		else
+		{
+			// the 12-bit unpacking converts straight into the output format
+			dw->data.resize((size_t)dw->length * bytespersample);
+			if(stats)
 			{
-				RiffWriter::ScopedDescend sd(wav, "smpl");
-				SamplerInfo si = {};
-				si.dwSamplePeriod = (uint32_t)(1000000000ui64 / samplerate);
-				si.dwMIDIUnityNote = orgkey;
-				si.cSampleLoops = looped ? 1 : 0;
-				wav.write(&si, sizeof(si));
-				if(looped)
-				{
-					SamplerLoop sl = {};
-					sl.dwType = LoopTypeForward;
-					sl.dwStart = loopbegin;
-					sl.dwEnd = loopend;
-					wav.write(&sl, sizeof(sl));
-				}
+				// the 16-bit samples are analyzed as they are unpacked, the others through a chunk of them
+				if     (options.format == TXWSampleFormatInt24) unpackAnalyzed(img, dw->data.data(), 3, TXWUnpack::unpackInt24, stats);
+				else if(options.format == TXWSampleFormatFloat32) unpackAnalyzed(img, (float*)dw->data.data(), 1, unpackfloat, stats);
+				else TXWAnalysis::unpack(img.pcm, (int16_t*)dw->data.data(), img.pcmlength / 2, stats);
 			}
+			else if(options.format == TXWSampleFormatInt24) txw.readInt24(dw->data.data(), dw->length);
+			else if(options.format == TXWSampleFormatFloat32) txw.read((float*)dw->data.data(), dw->length);
+			else txw.read((int16_t*)dw->data.data(), dw->length);
+		}
+	}
+	// the WAV file up to the header of the data chunk, collected in memory, the samples and the pad byte follow it.
+	// every chunk size is known ahead
+	static std::vector<char> makeWaveHeader(const TXWDECODEDWAVE& dw, uint8_t orgkey)
+	{
+		bool isfloat = dw.format == TXWSampleFormatFloat32;
+		uint32_t bytespersample = getBytesPerSample(dw.format);
+		uint32_t fmtsize = sizeof(WaveFormatEx);
+		uint32_t factsize = isfloat ? sizeof(uint32_t) : 0;
+		uint32_t smplsize = sizeof(SamplerInfo) + (dw.looped ? sizeof(SamplerLoop) : 0);
+		uint32_t datasize = dw.length * bytespersample;
+		uint32_t riffsize = 4 + RiffWriter::chunkSize(fmtsize) + (isfloat ? RiffWriter::chunkSize(factsize) : 0) + RiffWriter::chunkSize(smplsize) + RiffWriter::chunkSize(datasize);
+		RiffWriter wav(riffsize);
+		wav.write("WAVE", 4);
+		{
+			RiffWriter::ScopedDescend sd(wav, "fmt ", fmtsize);
+			WaveFormatEx wf = {};
+			wf.wFormatTag = isfloat ? WaveFormatIeeeFloat : WaveFormatPcm;
+			wf.nChannels = 1;
+			wf.nSamplesPerSec = dw.samplerate;
+			wf.nAvgBytesPerSec = dw.samplerate * bytespersample;
+			wf.nBlockAlign = (uint16_t)bytespersample;
+			wf.wBitsPerSample = (uint16_t)(bytespersample * 8);
+			wav.write(&wf, sizeof(wf));
+		}
+		if(isfloat)
+		{
+			// required for non-PCM formats
+			RiffWriter::ScopedDescend sd(wav, "fact", factsize);
+			wav.write(&dw.length, sizeof(dw.length));
+		}
+		{
+			RiffWriter::ScopedDescend sd(wav, "smpl", smplsize);
+			SamplerInfo si = {};
+			si.dwSamplePeriod = (uint32_t)((uint64_t)1000000000 / dw.samplerate);
+			si.dwMIDIUnityNote = orgkey;
+			si.cSampleLoops = dw.looped ? 1 : 0;
+			wav.write(&si, sizeof(si));
+			if(dw.looped)
 			{
-				RiffWriter::ScopedDescend sd(wav, "data");
-				uint8_t bb[3]; uint16_t bw[2];
-				for(unsigned int is = 0; is < pcmlength; is += 2)
-				{
-					txw.read((char*)bb, 3);
-					bw[0] = ((uint16_t)bb[0] << 8) | ((uint16_t)bb[1] & 0xF0);
-					bw[1] = ((uint16_t)bb[2] << 8) | (((uint16_t)bb[1] & 0x0f) << 4);
-					wav.write(bw, sizeof(bw));
-				}
+				SamplerLoop sl = {};
+				sl.dwType = LoopTypeForward;
+				sl.dwStart = dw.loopbegin;
+				sl.dwEnd = dw.loopend;
+				wav.write(&sl, sizeof(sl));
 			}
+		}
+		wav.descend("data", datasize);
+		return wav.detach();
+	}
+	// the header is handed to the sink with the samples as they are.
+	// FLAC if the wave was decoded for it. throws on failure
+	static void writeWave(const TXWDECODEDWAVE& dw, OutputSink& sink, const std::string& name, uint8_t orgkey, bool overwrite)
+	{
+		if(dw.filetype == TXWFileTypeFlac)
+		{
+			writeFlac(dw, sink, name, orgkey, overwrite);
+			return;
+		}
+		if(!overwrite && sink.exists(name)) throw std::runtime_error("path exists");
+		std::vector<char> header = makeWaveHeader(dw, orgkey);
+		uint8_t pad = 0;
+		OutputSink::SPAN parts[] = { { header.data(), header.size() }, { dw.data.data(), dw.data.size() }, { &pad, dw.data.size() & 0x01 } };
+		sink.write(name, parts, std::size(parts), false);
+	}
+	// the WAV header goes in APPLICATION "riff" blocks as flac --keep-foreign-metadata stores it: the RIFF header,
+	// each chunk, and the header of the data chunk, so that the WAV file can be restored, and the samplers find the sampler chunk
+	static void writeFlac(const TXWDECODEDWAVE& dw, OutputSink& sink, const std::string& name, uint8_t orgkey, bool overwrite)
+	{
+		if(!overwrite && sink.exists(name)) throw std::runtime_error("path exists");
+		std::vector<char> header = makeWaveHeader(dw, orgkey);
+		std::vector<FlacEncoder::APPLICATION> applications;
+		for(size_t pos = 0, c = 0; pos < header.size(); pos += c)
+		{
+			uint32_t cksize = 0;
+			memcpy(&cksize, header.data() + pos + 4, 4);
+			if(pos == 0) c = 12;
+			else if(pos + 8 == header.size()) c = 8;
+			else c = RiffWriter::chunkSize(cksize);
+			FlacEncoder::APPLICATION app;
+			memcpy(app.id, "riff", 4);
+			app.data.assign(header.data() + pos, header.data() + pos + c);
+			applications.push_back(app);
+		}
+		std::vector<uint8_t> stream;
+		FlacEncoder::encode(dw.data.data(), dw.length, getBytesPerSample(dw.format) * 8, dw.samplerate, applications, &stream);
+		sink.write(name, stream.data(), stream.size(), false);
+	}
+	static void writeWave(const TXWDECODEDWAVE& dw, const std::filesystem::path& wavpath, uint8_t orgkey, bool overwrite)
+	{
+		DirectorySink sink(wavpath.parent_path());
+		writeWave(dw, sink, wavpath.filename().string(), orgkey, overwrite);
+	}
+	// the options as recorded in the build manifests
+	static std::string formatWaveOptions(const TXWWaveOptions& options)
+	{
+		return StrUtil::format(64, "f%d r%u", (int)options.format, options.samplerate) + ((options.filetype == TXWFileTypeFlac) ? " flac" : "");
+	}
+	// the key of the converted file: the pcm, the rate and the loop, the options and the original key
+	static ContentHash hashWave(const TXWWaveReader& txw, const TXWWaveOptions& options, uint8_t orgkey)
+	{
+		const uint64_t version = 2; // bump when the output of the same input changes
+		const TXWWAVEIMAGE& img = txw.getImage();
+		ContentHash pcm = ContentHash::compute(img.pcm, img.pcmbytes);
+		uint64_t meta[] =
+		{
+			version,
+			txw.getSampleRate(),
+			txw.getLength(),
+			txw.isLooped() ? 1u : 0u,
+			txw.getLoopStart(),
+			txw.getLoopEnd(),
+			(uint64_t)options.format | ((uint64_t)options.filetype << 8), // the same keys as before for WAV
+			options.samplerate,
+			orgkey,
+			pcm.h0,
+			pcm.h1,
+		};
+		return ContentHash::compute(meta, sizeof(meta));
+	}
+	static bool convertWave(const std::filesystem::path& txwpath, const std::filesystem::path& wavpath, uint8_t orgkey, bool overwrite, const TXWWaveOptions& options, std::string* err)
+	{
+		bool r = false;
+		try
+		{
+			TXWWaveReader txw(txwpath);
+			TXWDECODEDWAVE dw;
+			decodeWave(txw, options, &dw);
+			writeWave(dw, wavpath, orgkey, overwrite);
+			r = true;
+		}
+		catch(std::exception& e)
+		{
+			*err = e.what();
+			r = false;
+		}
+		return r;
+	}
+	// converts a wave file image already in memory, e.g. from a FileSource or an upload, into the sink
+	static bool convertWave(const uint8_t* p, size_t c, OutputSink& sink, const std::string& name, uint8_t orgkey, bool overwrite, const TXWWaveOptions& options, std::string* err)
+	{
+		bool r = false;
+		try
+		{
+			TXWWaveReader txw(p, c);
+			TXWDECODEDWAVE dw;
+			decodeWave(txw, options, &dw);
+			writeWave(dw, sink, name, orgkey, overwrite);
 			r = true;
 		}
 		catch(std::exception& e)
@@ -0,0 +1,177 @@
+//
+//  tx16wview.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#include "tx16wtypes.h"
+
+// ================================================================================
+// views
+
+// packed records in place in a file image, nothing is copied and a field is decoded only when it is read.
+// the records fit in the image, as checked when the view was made, and the index is checked at each access.
+template<typename T> class TXWRecordView
+{
+protected:
+	const T* mRecords;
+	size_t mCount;
+public:
+	TXWRecordView() : mRecords(nullptr), mCount(0)
+	{
+	}
+	TXWRecordView(const T* p, size_t count) : mRecords(p), mCount(count)
+	{
+	}
+	size_t size() const
+	{
+		return mCount;
+	}
+	bool empty() const
+	{
+		return mCount == 0;
+	}
+	// throws on out of range
+	const T& operator[](size_t i) const
+	{
+		if(mCount <= i) throw std::out_of_range("record index out of range");
+		return mRecords[i];
+	}
+	const T* begin() const
+	{
+		return mRecords;
+	}
+	const T* end() const
+	{
+		return mRecords + mCount;
+	}
+};
+
+// a bank file image, which must outlive the view: the header, then the arrays of records one after another
+class TXWFileView
+{
+protected:
+	const uint8_t* mData;
+	size_t mSize;
+	size_t mOffset;
+	bool mIsV2;
+	std::string mKind;
+	// the next count records, throws if the image ends before them
+	template<typename T> TXWRecordView<T> next(size_t count)
+	{
+		if((mSize - mOffset) / sizeof(T) < count) throw std::runtime_error(mKind + ": truncated");
+		TXWRecordView<T> records((const T*)(mData + mOffset), count);
+		mOffset += count * sizeof(T);
+		return records;
+	}
+public:
+	// kind: the name of the file in the messages, throws on an invalid header
+	TXWFileView(const uint8_t* p, size_t c, const std::string& kind) : mData(p), mSize(c), mOffset(sizeof(TXWFILEHDR)), mIsV2(false), mKind(kind)
+	{
+		if((c < sizeof(TXWFILEHDR)) || !((const TXWFILEHDR*)p)->isValid()) throw std::runtime_error(kind + ": invalid format");
+		mIsV2 = ((const TXWFILEHDR*)p)->isV2();
+	}
+	bool isV2() const
+	{
+		return mIsV2;
+	}
+};
+
+// the setup file (.S01): the setup and the names of the waves
+class TXWSetupView : public TXWFileView
+{
+protected:
+	TXWRecordView<TXWSETUPV1> mSetupV1;
+	TXWRecordView<TXWSETUPV2> mSetupV2;
+	TXWRecordView<TXWWAVENAME> mWaveNames;
+public:
+	TXWSetupView(const uint8_t* p, size_t c) : TXWFileView(p, c, "setup")
+	{
+		// the V2 setup is longer, its fields up to DeviceNumber are those of V1
+		if(mIsV2)
+		{
+			mSetupV2 = next<TXWSETUPV2>(1);
+			mSetupV1 = TXWRecordView<TXWSETUPV1>((const TXWSETUPV1*)&mSetupV2[0], 1);
+		}
+		else
+		{
+			mSetupV1 = next<TXWSETUPV1>(1);
+		}
+		mWaveNames = next<TXWWAVENAME>(TXW_COUNTOF_WAVES);
+	}
+	// the common fields of either version
+	const TXWSETUPV1& getSetupV1() const
+	{
+		return mSetupV1[0];
+	}
+	// throws on V1
+	const TXWSETUPV2& getSetupV2() const
+	{
+		return mSetupV2[0];
+	}
+	const TXWRecordView<TXWWAVENAME>& getWaveNames() const
+	{
+		return mWaveNames;
+	}
+};
+
+// the performance file (.U01)
+class TXWPerformanceView : public TXWFileView
+{
+protected:
+	TXWRecordView<TXWPERF> mPerformances;
+public:
+	TXWPerformanceView(const uint8_t* p, size_t c) : TXWFileView(p, c, "performance")
+	{
+		mPerformances = next<TXWPERF>(TXW_COUNTOF_PERFS);
+	}
+	const TXWRecordView<TXWPERF>& getPerformances() const
+	{
+		return mPerformances;
+	}
+};
+
+// the voice file (.V01): the voices and the timbres, and their V2 extras
+class TXWVoiceView : public TXWFileView
+{
+protected:
+	TXWRecordView<TXWVOICE> mVoices;
+	TXWRecordView<TXWTIMBRE> mTimbres;
+	TXWRecordView<TXWVOICEV2EXTRA> mVoicesV2X;
+	TXWRecordView<TXWTIMBREV2EXTRA> mTimbresV2X;
+public:
+	TXWVoiceView(const uint8_t* p, size_t c) : TXWFileView(p, c, "voice")
+	{
+		mVoices = next<TXWVOICE>(TXW_COUNTOF_VOICES);
+		mTimbres = next<TXWTIMBRE>(mIsV2 ? TXW_COUNTOF_TIMBRES_V2 : TXW_COUNTOF_TIMBRES_V1);
+		if(mIsV2)
+		{
+			mVoicesV2X = next<TXWVOICEV2EXTRA>(TXW_COUNTOF_VOICES);
+			mTimbresV2X = next<TXWTIMBREV2EXTRA>(TXW_COUNTOF_TIMBRES_V2);
+		}
+		// and still remains extra 432 bytes
+	}
+	const TXWRecordView<TXWVOICE>& getVoices() const
+	{
+		return mVoices;
+	}
+	const TXWRecordView<TXWTIMBRE>& getTimbres() const
+	{
+		return mTimbres;
+	}
+	// empty on V1
+	const TXWRecordView<TXWVOICEV2EXTRA>& getVoicesV2X() const
+	{
+		return mVoicesV2X;
+	}
+	const TXWRecordView<TXWTIMBREV2EXTRA>& getTimbresV2X() const
+	{
+		return mTimbresV2X;
+	}
+};
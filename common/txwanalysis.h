@@ -0,0 +1,228 @@
+//
+//  txwanalysis.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include "cpufeatures.h"
+#include "txwunpack.h"
+
+// statistics of the samples of a wave: the peak, the RMS, the DC offset, the clipped samples and the silence at both ends.
+// the sums are of the 12-bit values, so that they are exact, and the levels are relative to the full scale.
+struct TXWSampleStats
+{
+	enum
+	{
+		SilenceThreshold = 32, // -60 dBFS in 16-bit, i.e. 2 steps of the 12-bit samples
+		ClipLow = -32768,
+		ClipHigh = 32752, // the largest 12-bit sample in 16-bit
+	};
+	uint32_t length = 0; // the samples analyzed so far
+	uint32_t peak = 0; // the largest magnitude in 16-bit
+	int64_t sum = 0;
+	uint64_t sumsquares = 0;
+	uint32_t clipped = 0; // at either limit
+	uint32_t start = UINT32_MAX, end = 0; // the first and the last sample above the threshold, i.e. the trimming points
+	bool isSilent() const
+	{
+		return end < start;
+	}
+	double getPeak() const
+	{
+		return (double)peak / 32768.0;
+	}
+	double getRMS() const
+	{
+		return length ? std::sqrt((double)sumsquares / length) / 2048.0 : 0.0;
+	}
+	double getDCOffset() const
+	{
+		return length ? (double)sum / length / 2048.0 : 0.0;
+	}
+	// -inf for 0
+	static double toDB(double v)
+	{
+		return (0 < v) ? 20.0 * std::log10(v) : -HUGE_VAL;
+	}
+};
+
+// the 12-bit unpacking into 16-bit with the statistics gathered from the same registers, in one pass.
+// the position of the samples in the wave is the length of the stats so far, so that a wave can be taken in chunks.
+struct TXWAnalysis
+{
+	enum { ChunkGroups = 1024 }; // 2048 samples, the source and the samples of a chunk stay in the L1 cache
+	using Kernel = void(*)(const uint8_t* src, int16_t* dst, size_t numgroups, TXWSampleStats* stats);
+	static void accumulateScalar(const int16_t* s, size_t n, TXWSampleStats* stats)
+	{
+		for(size_t i = 0; i < n; i ++)
+		{
+			int32_t v = s[i];
+			uint32_t a = (uint32_t)std::abs(v);
+			int32_t w = v >> 4;
+			stats->peak = std::max(stats->peak, a);
+			stats->sum += w;
+			stats->sumsquares += (uint64_t)(w * w);
+			if((v == TXWSampleStats::ClipLow) || (v == TXWSampleStats::ClipHigh)) stats->clipped ++;
+			if(TXWSampleStats::SilenceThreshold < a)
+			{
+				if(stats->start == UINT32_MAX) stats->start = stats->length;
+				stats->end = stats->length;
+			}
+			stats->length ++;
+		}
+	}
+	static void unpackScalar(const uint8_t* src, int16_t* dst, size_t numgroups, TXWSampleStats* stats)
+	{
+		for(size_t n = 0; 0 < numgroups; numgroups -= n, src += n * 3, dst += n * 2)
+		{
+			n = std::min((size_t)ChunkGroups, numgroups);
+			TXWUnpack::unpackScalar(src, dst, n);
+			accumulateScalar(dst, n * 2, stats);
+		}
+	}
+#if TXW_X86
+	// the lanes of a mask of pcmpeqw/pcmpgtw, which has 2 bits for each
+	static int getFirstLane(unsigned int mask)
+	{
+		int i = 0;
+		while(!(mask & 1)) { mask >>= 2; i ++; }
+		return i;
+	}
+	static int getLastLane(unsigned int mask)
+	{
+		int i = -1;
+		while(mask) { mask >>= 2; i ++; }
+		return i;
+	}
+	// the lanes sum up to 2^23 per vector for the squares, so the 32-bit sums are moved into the stats every 128 vectors
+	TXW_TARGET_SSE2 static void unpackSSE2(const uint8_t* src, int16_t* dst, size_t numgroups, TXWSampleStats* stats)
+	{
+		const __m128i ones = _mm_set1_epi16(1);
+		const __m128i cliplo = _mm_set1_epi16((short)TXWSampleStats::ClipLow), cliphi = _mm_set1_epi16((short)TXWSampleStats::ClipHigh);
+		const __m128i thrhi = _mm_set1_epi16(TXWSampleStats::SilenceThreshold), thrlo = _mm_set1_epi16(-TXWSampleStats::SilenceThreshold);
+		__m128i vmin = _mm_setzero_si128(), vmax = _mm_setzero_si128();
+		uint32_t pos = stats->length, start = stats->start, lastpos = 0;
+		unsigned int lastmask = 0;
+		while(6 <= numgroups)
+		{
+			__m128i vsum = _mm_setzero_si128(), vsquares = _mm_setzero_si128(), vclipped = _mm_setzero_si128();
+			for(size_t cv = std::min((numgroups - 2) / 4, (size_t)128), iv = 0; iv < cv; iv ++, src += 12, dst += 8, numgroups -= 4, pos += 8)
+			{
+				__m128i s = TXWUnpack::decodeSSE2(src);
+				_mm_storeu_si128((__m128i*)dst, s);
+				vmin = _mm_min_epi16(vmin, s);
+				vmax = _mm_max_epi16(vmax, s);
+				__m128i w = _mm_srai_epi16(s, 4);
+				vsum = _mm_add_epi32(vsum, _mm_madd_epi16(w, ones));
+				vsquares = _mm_add_epi32(vsquares, _mm_madd_epi16(w, w));
+				vclipped = _mm_sub_epi16(vclipped, _mm_or_si128(_mm_cmpeq_epi16(s, cliplo), _mm_cmpeq_epi16(s, cliphi)));
+				unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi16(s, thrhi), _mm_cmplt_epi16(s, thrlo)));
+				if(mask)
+				{
+					if(start == UINT32_MAX) start = pos + getFirstLane(mask);
+					lastpos = pos;
+					lastmask = mask;
+				}
+			}
+			int32_t sums[4], squares[4], clipped[4];
+			_mm_storeu_si128((__m128i*)sums, vsum);
+			_mm_storeu_si128((__m128i*)squares, vsquares);
+			_mm_storeu_si128((__m128i*)clipped, _mm_madd_epi16(vclipped, ones));
+			for(int i = 0; i < 4; i ++)
+			{
+				stats->sum += sums[i];
+				stats->sumsquares += (uint32_t)squares[i];
+				stats->clipped += clipped[i];
+			}
+		}
+		int16_t mins[8], maxs[8];
+		_mm_storeu_si128((__m128i*)mins, vmin);
+		_mm_storeu_si128((__m128i*)maxs, vmax);
+		for(int i = 0; i < 8; i ++) stats->peak = std::max(stats->peak, (uint32_t)std::max(-(int32_t)mins[i], (int32_t)maxs[i]));
+		stats->start = start;
+		if(lastmask) stats->end = lastpos + getLastLane(lastmask);
+		stats->length = pos;
+		unpackScalar(src, dst, numgroups, stats);
+	}
+	TXW_TARGET_AVX2 static void unpackAVX2(const uint8_t* src, int16_t* dst, size_t numgroups, TXWSampleStats* stats)
+	{
+		const __m256i ones = _mm256_set1_epi16(1);
+		const __m256i cliplo = _mm256_set1_epi16((short)TXWSampleStats::ClipLow), cliphi = _mm256_set1_epi16((short)TXWSampleStats::ClipHigh);
+		const __m256i thrhi = _mm256_set1_epi16(TXWSampleStats::SilenceThreshold), thrlo = _mm256_set1_epi16(-TXWSampleStats::SilenceThreshold);
+		__m256i vmin = _mm256_setzero_si256(), vmax = _mm256_setzero_si256();
+		uint32_t pos = stats->length, start = stats->start, lastpos = 0;
+		unsigned int lastmask = 0;
+		while(10 <= numgroups)
+		{
+			__m256i vsum = _mm256_setzero_si256(), vsquares = _mm256_setzero_si256(), vclipped = _mm256_setzero_si256();
+			for(size_t cv = std::min((numgroups - 2) / 8, (size_t)128), iv = 0; iv < cv; iv ++, src += 24, dst += 16, numgroups -= 8, pos += 16)
+			{
+				__m256i s = TXWUnpack::decodeAVX2(src);
+				_mm256_storeu_si256((__m256i*)dst, s);
+				vmin = _mm256_min_epi16(vmin, s);
+				vmax = _mm256_max_epi16(vmax, s);
+				__m256i w = _mm256_srai_epi16(s, 4);
+				vsum = _mm256_add_epi32(vsum, _mm256_madd_epi16(w, ones));
+				vsquares = _mm256_add_epi32(vsquares, _mm256_madd_epi16(w, w));
+				vclipped = _mm256_sub_epi16(vclipped, _mm256_or_si256(_mm256_cmpeq_epi16(s, cliplo), _mm256_cmpeq_epi16(s, cliphi)));
+				unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpgt_epi16(s, thrhi), _mm256_cmpgt_epi16(thrlo, s)));
+				if(mask)
+				{
+					if(start == UINT32_MAX) start = pos + getFirstLane(mask);
+					lastpos = pos;
+					lastmask = mask;
+				}
+			}
+			int32_t sums[8], squares[8], clipped[8];
+			_mm256_storeu_si256((__m256i*)sums, vsum);
+			_mm256_storeu_si256((__m256i*)squares, vsquares);
+			_mm256_storeu_si256((__m256i*)clipped, _mm256_madd_epi16(vclipped, ones));
+			for(int i = 0; i < 8; i ++)
+			{
+				stats->sum += sums[i];
+				stats->sumsquares += (uint32_t)squares[i];
+				stats->clipped += clipped[i];
+			}
+		}
+		int16_t mins[16], maxs[16];
+		_mm256_storeu_si256((__m256i*)mins, vmin);
+		_mm256_storeu_si256((__m256i*)maxs, vmax);
+		for(int i = 0; i < 16; i ++) stats->peak = std::max(stats->peak, (uint32_t)std::max(-(int32_t)mins[i], (int32_t)maxs[i]));
+		stats->start = start;
+		if(lastmask) stats->end = lastpos + getLastLane(lastmask);
+		stats->length = pos;
+		unpackSSE2(src, dst, numgroups, stats);
+	}
+#endif
+	static Kernel getKernel(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return unpackAVX2;
+		if(level == CpuFeatures::LevelSSE2) return unpackSSE2;
+#endif
+		return unpackScalar;
+	}
+	// unpacks numgroups * 3 bytes into numgroups * 2 samples and adds them to the stats, with the best kernel for this machine
+	static void unpack(const uint8_t* src, int16_t* dst, size_t numgroups, TXWSampleStats* stats)
+	{
+		static const Kernel kernel = getKernel(CpuFeatures::getLevel());
+		kernel(src, dst, numgroups, stats);
+	}
+	// the stats alone, the samples go through a chunk on the stack
+	static void analyze(const uint8_t* src, size_t numgroups, TXWSampleStats* stats)
+	{
+		int16_t chunk[ChunkGroups * 2];
+		for(size_t n = 0; 0 < numgroups; numgroups -= n, src += n * 3)
+		{
+			n = std::min((size_t)ChunkGroups, numgroups);
+			unpack(src, chunk, n, stats);
+		}
+	}
+};
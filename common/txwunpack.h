@@ -0,0 +1,190 @@
+//
+//  txwunpack.h
+//  TXWConvert
+//
+//  Created by yu2924 on 2026-10-17
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cpufeatures.h"
+
+// 12-bit sample unpacking into 16-bit, 24-bit and 32-bit float samples
+// a group of 3 bytes holds 2 samples (cf. tx16w.tec.txt):
+//   s0 = (b0 << 8) | (b1 & 0xf0)
+//   s1 = (b2 << 8) | ((b1 & 0x0f) << 4)
+
+struct TXWUnpack
+{
+	using Kernel = void(*)(const uint8_t* src, int16_t* dst, size_t numgroups);
+	using KernelFloat32 = void(*)(const uint8_t* src, float* dst, size_t numgroups);
+	using KernelInt24 = void(*)(const uint8_t* src, uint8_t* dst, size_t numgroups);
+	// 16-bit
+	static void unpackScalar(const uint8_t* src, int16_t* dst, size_t numgroups)
+	{
+		for(size_t ig = 0; ig < numgroups; ig ++, src += 3, dst += 2)
+		{
+			dst[0] = (int16_t)(((uint16_t)src[0] << 8) | ((uint16_t)src[1] & 0xf0));
+			dst[1] = (int16_t)(((uint16_t)src[2] << 8) | (((uint16_t)src[1] & 0x0f) << 4));
+		}
+	}
+	// 32-bit float, scaled to [-1,1)
+	static void unpackFloat32Scalar(const uint8_t* src, float* dst, size_t numgroups)
+	{
+		int16_t pair[2];
+		for(size_t ig = 0; ig < numgroups; ig ++, src += 3, dst += 2)
+		{
+			unpackScalar(src, pair, 1);
+			dst[0] = (float)pair[0] * (1.0f / 32768.0f);
+			dst[1] = (float)pair[1] * (1.0f / 32768.0f);
+		}
+	}
+	// 24-bit, 3 bytes little endian per sample
+	static void unpackInt24Scalar(const uint8_t* src, uint8_t* dst, size_t numgroups)
+	{
+		for(size_t ig = 0; ig < numgroups; ig ++, src += 3, dst += 6)
+		{
+			dst[0] = 0;
+			dst[1] = src[1] & 0xf0;
+			dst[2] = src[0];
+			dst[3] = 0;
+			dst[4] = (uint8_t)(src[1] << 4);
+			dst[5] = src[2];
+		}
+	}
+#if TXW_X86
+	// 4 groups into 8 samples, 16 bytes are loaded for 12 consumed
+	TXW_TARGET_SSE2 static __m128i decodeSSE2(const uint8_t* src)
+	{
+		// gather the 24-bit groups into 32-bit lanes: b0 | b1 << 8 | b2 << 16
+		__m128i a = _mm_loadu_si128((const __m128i*)src);
+		__m128i ab = _mm_unpacklo_epi32(a, _mm_srli_si128(a, 3));
+		__m128i cd = _mm_unpacklo_epi32(_mm_srli_si128(a, 6), _mm_srli_si128(a, 9));
+		__m128i v = _mm_unpacklo_epi64(ab, cd);
+		return _mm_or_si128(_mm_or_si128(
+			_mm_and_si128(_mm_slli_epi32(v, 8), _mm_set1_epi32((int)0xff00ff00)),
+			_mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0x000000f0))),
+			_mm_and_si128(_mm_slli_epi32(v, 12), _mm_set1_epi32(0x00f00000)));
+	}
+	// 8 groups into 16 samples, each 128-bit lane shuffles 4 groups into b1,b0,b1,b2 order
+	TXW_TARGET_AVX2 static __m256i decodeAVX2(const uint8_t* src)
+	{
+		const __m256i shuf = _mm256_setr_epi8(
+			1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11,
+			1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11);
+		__m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i*)src)),
+			_mm_loadu_si128((const __m128i*)(src + 12)), 1);
+		__m256i v = _mm256_shuffle_epi8(a, shuf);
+		return _mm256_or_si256(
+			_mm256_and_si256(v, _mm256_set1_epi32((int)0xff00fff0)),
+			_mm256_and_si256(_mm256_slli_epi32(v, 4), _mm256_set1_epi32(0x00f00000)));
+	}
+	TXW_TARGET_SSE2 static void unpackSSE2(const uint8_t* src, int16_t* dst, size_t numgroups)
+	{
+		for(; 6 <= numgroups; numgroups -= 4, src += 12, dst += 8)
+		{
+			_mm_storeu_si128((__m128i*)dst, decodeSSE2(src));
+		}
+		unpackScalar(src, dst, numgroups);
+	}
+	TXW_TARGET_AVX2 static void unpackAVX2(const uint8_t* src, int16_t* dst, size_t numgroups)
+	{
+		for(; 10 <= numgroups; numgroups -= 8, src += 24, dst += 16)
+		{
+			_mm256_storeu_si256((__m256i*)dst, decodeAVX2(src));
+		}
+		unpackSSE2(src, dst, numgroups);
+	}
+	TXW_TARGET_SSE2 static void unpackFloat32SSE2(const uint8_t* src, float* dst, size_t numgroups)
+	{
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+		for(; 6 <= numgroups; numgroups -= 4, src += 12, dst += 8)
+		{
+			__m128i s = decodeSSE2(src);
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+			_mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+		unpackFloat32Scalar(src, dst, numgroups);
+	}
+	TXW_TARGET_AVX2 static void unpackFloat32AVX2(const uint8_t* src, float* dst, size_t numgroups)
+	{
+		const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+		for(; 10 <= numgroups; numgroups -= 8, src += 24, dst += 16)
+		{
+			__m256i s = decodeAVX2(src);
+			__m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s));
+			__m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s, 1));
+			_mm256_storeu_ps(dst + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+			_mm256_storeu_ps(dst + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+		}
+		unpackFloat32SSE2(src, dst, numgroups);
+	}
+	// 4 groups into 24 bytes, the packing needs pshufb which every AVX2 machine has
+	TXW_TARGET_AVX2 static void unpackInt24AVX2(const uint8_t* src, uint8_t* dst, size_t numgroups)
+	{
+		const __m128i shuf0 = _mm_setr_epi8(-1, 1, 0, -1, 1, 2, -1, 4, 3, -1, 4, 5, -1, 7, 6, -1);
+		const __m128i shuf1 = _mm_setr_epi8(7, 8, -1, 10, 9, -1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+		// keep the high nibble of b1 for the first sample, take the low nibble shifted up for the second
+		const __m128i keep0 = _mm_setr_epi8(-1, (char)0xf0, -1, -1, 0, -1, -1, (char)0xf0, -1, -1, 0, -1, -1, (char)0xf0, -1, -1);
+		const __m128i nib0 = _mm_setr_epi8(0, 0, 0, 0, (char)0xf0, 0, 0, 0, 0, 0, (char)0xf0, 0, 0, 0, 0, 0);
+		const __m128i keep1 = _mm_setr_epi8(0, -1, -1, (char)0xf0, -1, -1, 0, -1, 0, 0, 0, 0, 0, 0, 0, 0);
+		const __m128i nib1 = _mm_setr_epi8((char)0xf0, 0, 0, 0, 0, 0, (char)0xf0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		for(; 6 <= numgroups; numgroups -= 4, src += 12, dst += 24)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)src);
+			__m128i s0 = _mm_shuffle_epi8(a, shuf0);
+			__m128i s1 = _mm_shuffle_epi8(a, shuf1);
+			__m128i o0 = _mm_or_si128(_mm_and_si128(s0, keep0), _mm_and_si128(_mm_slli_epi16(s0, 4), nib0));
+			__m128i o1 = _mm_or_si128(_mm_and_si128(s1, keep1), _mm_and_si128(_mm_slli_epi16(s1, 4), nib1));
+			_mm_storeu_si128((__m128i*)dst, o0);
+			_mm_storel_epi64((__m128i*)(dst + 16), o1);
+		}
+		unpackInt24Scalar(src, dst, numgroups);
+	}
+#endif
+	static Kernel getKernel(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return unpackAVX2;
+		if(level == CpuFeatures::LevelSSE2) return unpackSSE2;
+#endif
+		return unpackScalar;
+	}
+	static KernelFloat32 getKernelFloat32(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return unpackFloat32AVX2;
+		if(level == CpuFeatures::LevelSSE2) return unpackFloat32SSE2;
+#endif
+		return unpackFloat32Scalar;
+	}
+	static KernelInt24 getKernelInt24(CpuFeatures::Level level)
+	{
+#if TXW_X86
+		if(level == CpuFeatures::LevelAVX2) return unpackInt24AVX2;
+#endif
+		return unpackInt24Scalar;
+	}
+	// unpacks numgroups * 3 bytes into numgroups * 2 samples with the best kernel for this machine
+	static void unpack(const uint8_t* src, int16_t* dst, size_t numgroups)
+	{
+		static const Kernel kernel = getKernel(CpuFeatures::getLevel());
+		kernel(src, dst, numgroups);
+	}
+	static void unpack(const uint8_t* src, float* dst, size_t numgroups)
+	{
+		static const KernelFloat32 kernel = getKernelFloat32(CpuFeatures::getLevel());
+		kernel(src, dst, numgroups);
+	}
+	// dst receives numgroups * 6 bytes
+	static void unpackInt24(const uint8_t* src, uint8_t* dst, size_t numgroups)
+	{
+		static const KernelInt24 kernel = getKernelInt24(CpuFeatures::getLevel());
+		kernel(src, dst, numgroups);
+	}
+};